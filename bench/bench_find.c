@@ -0,0 +1,111 @@
+#include <stdio.h>  // for printf, snprintf, fopen, fprintf, remove
+#include <stdlib.h>  // for atoi
+#include <string.h>  // for memset, strcat
+#include <time.h>  // for clock_gettime
+#include "database.h"  // for the Database handle API
+
+// opens a file of generated names, which builds the index, then times FIND NAME for name prefixes, surnames,
+// substrings and misses, and the cost the index adds to every later insert and rename
+
+static const char *dataPath = "bench_find.txt";
+
+static const char *syllables[] = {"an", "bel", "chen", "dor", "el", "fa", "gor", "hin", "jo", "ka",
+                                  "lee", "mar", "nor", "ol", "pet", "quin", "ros", "sun", "tan", "wu"};
+
+static unsigned state = 2024;
+
+static unsigned nextRandom(void) {
+    state = state * 1103515245u + 12345u;
+    return state >> 8;
+}
+
+// two or three words of one to three syllables, about 8000 distinct words
+static void randomName(char *out, size_t n) {
+    memset(out, 0, n);
+    int words = 2 + (int)(nextRandom() % 2);
+    for (int w = 0; w < words; w++) {
+        if (w) strcat(out, " ");
+        int parts = 1 + (int)(nextRandom() % 3);
+        for (int p = 0; p < parts; p++) strcat(out, syllables[nextRandom() % 20]);
+    }
+    out[0] = (char)(out[0] - 'a' + 'A');
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int ignoreRow(const Student *s, void *ctx) {
+    (void)s;
+    (void)ctx;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    size_t records = (argc > 1) ? (size_t)atoi(argv[1]) : 1000000;
+    int rounds = 200;  // searches per query
+    const char *queries[][2] = {
+        {"name prefix", "chenjo"}, {"surname", "rossun"}, {"substring", "orquin"},
+        {"full name", "Chen Wu"}, {"one letter", "w"}, {"no match", "xyz"},
+    };
+
+    Student s;
+    memset(&s, 0, sizeof s);
+    snprintf(s.programme, sizeof s.programme, "Computer Science");
+    s.mark = 50.0f;
+    FILE *fp = fopen(dataPath, "w");
+    if (!fp) {
+        perror(dataPath);
+        return 1;
+    }
+    fprintf(fp, "ID\tName\tProgramme\tMark\n");
+    for (size_t i = 0; i < records; i++) {
+        randomName(s.name, sizeof s.name);
+        fprintf(fp, "%d\t%s\t%s\t%.1f\n", 1000000 + (int)i, s.name, s.programme, s.mark);
+    }
+    fclose(fp);
+
+    Database *db = db_create(NULL);
+    double start = now();
+    if (!db || db_open(db, dataPath) != DB_OK) { // OPEN builds the index
+        perror("open");
+        return 1;
+    }
+    printf("%zu names, opened and indexed in %.1f ms\n", records, (now() - start) * 1000.0);
+    start = now();
+    long found = db_find_name(db, "a", FIND_LIMIT, ignoreRow, NULL);
+    printf("first search: %.1f us\n", (now() - start) * 1e6);
+    if (found < 0) return 1;
+
+    printf("%-12s %-10s %8s %12s %12s\n", "Query", "Text", "Matches", "Avg (us)", "Max (us)");
+    for (size_t q = 0; q < sizeof queries / sizeof queries[0]; q++) {
+        double total = 0, worst = 0;
+        for (int r = 0; r < rounds; r++) {
+            double t0 = now();
+            found = db_find_name(db, queries[q][1], FIND_LIMIT, ignoreRow, NULL);
+            double us = (now() - t0) * 1e6;
+            total += us;
+            if (us > worst) worst = us;
+        }
+        printf("%-12s %-10s %8ld %12.1f %12.1f\n", queries[q][0], queries[q][1], found, total / rounds, worst);
+    }
+
+    // inserts and renames now also update the index, merges of new words into the sorted order included
+    size_t changes = records / 10;
+    start = now();
+    for (size_t i = 0; i < changes; i++) {
+        s.id = 1000000 + (int)(nextRandom() % records);
+        randomName(s.name, sizeof s.name);
+        if (db_update(db, &s) != DB_OK) return 1;
+    }
+    printf("%zu renames with the index: %.2f us each\n", changes, (now() - start) * 1e6 / (double)changes);
+    start = now();
+    found = db_find_name(db, "chenjo", FIND_LIMIT, ignoreRow, NULL);
+    printf("search after the renames: %.1f us, %ld matches\n", (now() - start) * 1e6, found);
+
+    db_destroy(db);
+    remove(dataPath);
+    return 0;
+}
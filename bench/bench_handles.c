@@ -0,0 +1,142 @@
+#include <stdio.h>  // for printf, snprintf
+#include <stdlib.h>  // for malloc, realloc, free, atoi
+#include <string.h>  // for memset
+#include <time.h>  // for clock_gettime
+#include <pthread.h>  // for pthread_create, pthread_join
+#include "database.h"  // for the Database handle API
+
+// runs the same workload on 1, 2, 4 and 8 handles, one handle per thread
+// handles share no state, so the time per round should stay flat as threads are added
+
+#define MAX_THREADS 8
+
+typedef struct {
+    size_t bytes;  // bytes currently allocated through this handle
+    size_t peak;
+} Usage;
+
+// counting allocator, one per handle so the threads never touch the same counter
+typedef struct {
+    size_t size;
+} Header;
+
+static void *countAlloc(void *ctx, size_t size) {
+    Usage *u = ctx;
+    Header *h = malloc(sizeof *h + size);
+    if (!h) return NULL;
+    h->size = size;
+    u->bytes += size;
+    if (u->bytes > u->peak) u->peak = u->bytes;
+    return h + 1;
+}
+
+static void *countResize(void *ctx, void *ptr, size_t size) {
+    Usage *u = ctx;
+    if (!ptr) return countAlloc(ctx, size);
+    Header *h = (Header *)ptr - 1;
+    size_t old = h->size;
+    h = realloc(h, sizeof *h + size);
+    if (!h) return NULL;
+    h->size = size;
+    u->bytes = u->bytes - old + size;
+    if (u->bytes > u->peak) u->peak = u->bytes;
+    return h + 1;
+}
+
+static void countRelease(void *ctx, void *ptr) {
+    Usage *u = ctx;
+    Header *h = (Header *)ptr - 1;
+    u->bytes -= h->size;
+    free(h);
+}
+
+typedef struct {
+    int seed;  // makes every thread insert different IDs
+    size_t records;  // records inserted per handle
+    Usage usage;
+    int failed;
+} Worker;
+
+static int sumMarks(const Student *s, void *ctx) {
+    *(double *)ctx += s->mark;
+    return 0;
+}
+
+static void *runWorker(void *arg) {
+    Worker *w = arg;
+    DbAllocator mem = {countAlloc, countResize, countRelease, &w->usage};
+    Database *db = db_create(&mem);
+    if (!db) { w->failed = 1; return NULL; }
+
+    const char *codes[] = {"Computer Science", "Computer Engineering", "Electrical Engineering",
+                           "Artificial Intelligence", "Digital Supply Chain"};
+    unsigned state = (unsigned)w->seed * 2654435761u + 1;
+    for (size_t i = 0; i < w->records && !w->failed; i++) { // inserts, each one updates the ID index and change log
+        Student s;
+        memset(&s, 0, sizeof s);
+        s.id = 1000000 + (int)i;
+        state = state * 1103515245u + 12345u;
+        snprintf(s.name, sizeof s.name, "Student %c%c", 'A' + (int)(state >> 16) % 26, 'a' + (int)(state >> 8) % 26);
+        snprintf(s.programme, sizeof s.programme, "%s", codes[(state >> 4) % 5]);
+        s.mark = 1.0f + (float)((state >> 10) % 991) / 10.0f;  // 1.0 to 100.0
+        if (db_insert(db, 0, &s) != DB_OK) w->failed = 1;
+    }
+
+    for (size_t i = 0; i < w->records && !w->failed; i += 7) // point queries through the ID index
+        if (!db_query(db, 1000000 + (int)i)) w->failed = 1;
+
+    for (size_t i = 0; i < w->records && !w->failed; i += 97) { // updates repair the cached views
+        Student s = *db_query(db, 1000000 + (int)i);
+        s.mark = (s.mark <= 99.0f) ? s.mark + 0.5f : 1.0f;
+        if (db_update(db, &s) != DB_OK) w->failed = 1;
+    }
+
+    double total = 0;
+    DbSummary sum;
+    for (int f = 0; f < SORT_FIELD_COUNT && !w->failed; f++) { // full sorts and one ordered scan each
+        if (db_sort(db, (SortField)f, f % 2) != DB_OK) w->failed = 1;
+        db_foreach(db, sumMarks, &total);
+    }
+    db_summary(db, &sum);
+    if (sum.count != w->records) w->failed = 1;
+
+    db_destroy(db);
+    if (w->usage.bytes != 0) w->failed = 1; // every allocation went back through the handle's hooks
+    return NULL;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+    size_t records = (argc > 1) ? (size_t)atoi(argv[1]) : 200000;
+    pthread_t threads[MAX_THREADS];
+    Worker workers[MAX_THREADS];
+
+    printf("%zu records per handle\n", records);
+    printf("%8s %12s %16s %14s\n", "Handles", "Wall (ms)", "Records/s", "Peak KB/handle");
+    for (int n = 1; n <= MAX_THREADS; n *= 2) {
+        memset(workers, 0, sizeof workers);
+        double start = now();
+        for (int i = 0; i < n; i++) {
+            workers[i].seed = i + 1;
+            workers[i].records = records;
+            pthread_create(&threads[i], NULL, runWorker, &workers[i]);
+        }
+        for (int i = 0; i < n; i++) pthread_join(threads[i], NULL);
+        double elapsed = now() - start;
+
+        int failed = 0;
+        size_t peak = 0;
+        for (int i = 0; i < n; i++) {
+            failed |= workers[i].failed;
+            if (workers[i].usage.peak > peak) peak = workers[i].usage.peak;
+        }
+        printf("%8d %12.1f %16.0f %14zu%s\n", n, elapsed * 1000.0, (double)records * n / elapsed,
+               peak / 1024, failed ? "  FAILED" : "");
+    }
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include <stdio.h>  // for printf, fopen, fprintf, remove
+#include <stdlib.h>  // for atoi
+#include <string.h>  // for memset, strcpy
+#include <time.h>  // for clock_gettime
+#include <sys/stat.h>  // for stat
+#include "database.h"  // for the Database handle API
+
+// runs the same mix of updates, inserts and deletes as plain calls and as transactions of growing size
+// every commit syncs the journal once and applies its index and row changes in one pass,
+// so the cost per change should fall as more changes share a commit
+// afterwards checks recovery: replay after a crash, a torn block, replaying twice, files opened in another order
+// OPEN LAZY with a pending journal and a SAVE that replaced only some of the files
+
+static const char *dataPath = "bench_txn.txt";
+static const char *journalPath = "bench_txn.txt.journal";
+static const char *otherPath = "bench_txn_b.txt";
+static const char *otherJournalPath = "bench_txn_b.txt.journal";
+
+static unsigned state = 12345;
+
+static unsigned nextRandom(void) {
+    state = state * 1103515245u + 12345u;
+    return state >> 8;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long fileSize(const char *path) {
+    struct stat st;
+    return (stat(path, &st) == 0) ? (long)st.st_size : 0;
+}
+
+// one change of the mix: 8 in 10 update a mark, 1 inserts a new ID and 1 deletes an existing row
+static int randomChange(Database *db, size_t rows, int *nextId) {
+    int id = 1000000 + (int)(nextRandom() % rows);
+    for (size_t tries = 0; !db_query(db, id) && tries < rows; tries++) //skip rows deleted earlier
+        id = (id + 1 < 1000000 + (int)rows) ? id + 1 : 1000000;
+
+    switch (nextRandom() % 10) {
+        case 0: {
+            Student s;
+            memset(&s, 0, sizeof s);
+            s.id = (*nextId)++;
+            strcpy(s.name, "New Student");
+            strcpy(s.programme, "Computer Science");
+            s.mark = 1.0f + (float)(nextRandom() % 100);
+            return db_insert(db, 0, &s);
+        }
+        case 1:
+            return db_delete(db, id);
+        default: {
+            Student s = *db_query(db, id);
+            s.mark = (s.mark <= 99.0f) ? s.mark + 0.5f : 1.0f;
+            return db_update(db, &s);
+        }
+    }
+}
+
+// writes a small file of rows starting at an ID, returns 0 on success
+static int writeFile(const char *path, int firstId, size_t rows) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -1;
+    fprintf(fp, "ID\tName\tProgramme\tMark\n");
+    for (size_t i = 0; i < rows; i++) fprintf(fp, "%d\tStudent Number\tComputer Science\t50.0\n", firstId + (int)i);
+    return fclose(fp);
+}
+
+// opens the files in a new handle, as the next session after a crash would
+static Database *reopen(const char *paths, int *rc) {
+    Database *db = db_create(NULL);
+    *rc = db ? db_open(db, paths) : DB_ERR_NO_MEMORY;
+    return db;
+}
+
+static float markOf(Database *db, int id) {
+    const Student *s = db_query(db, id);
+    return s ? s->mark : -1.0f;
+}
+
+static int report(const char *check, int ok) {
+    printf("%-44s %s\n", check, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+// commits transactions, drops the handle without SAVE and checks what the next OPEN recovers
+static int checkRecovery(void) {
+    char both[64], swapped[64];
+    snprintf(both, sizeof both, "%s,%s", dataPath, otherPath);
+    snprintf(swapped, sizeof swapped, "%s,%s", otherPath, dataPath);
+    remove(journalPath);
+    remove(otherJournalPath);
+    if (writeFile(dataPath, 1000000, 10) != 0 || writeFile(otherPath, 3000000, 10) != 0) {
+        perror("recovery files");
+        return 1;
+    }
+
+    int rc, failures = 0;
+    TxnStats stats;
+    Database *db = reopen(both, &rc);
+    Student s = *db_query(db, 1000001);
+    s.mark = 77.0f;
+    Student added = s;
+    added.id = 3000100;
+    db_begin(db);
+    db_update(db, &s);
+    db_delete(db, 1000002);
+    db_insert(db, 1, &added); //second file, so the block names both
+    rc = db_commit(db);
+    db_destroy(db); //crash: the files were never saved
+
+    db = reopen(both, &rc);
+    db_txn_stats(db, &stats);
+    failures += report("replay after a crash", rc == DB_OK && stats.recovered == 1 && markOf(db, 1000001) == 77.0f &&
+                                               !db_query(db, 1000002) && db_query(db, 3000100) && db_count(db) == 20);
+    db_destroy(db);
+
+    db = reopen(both, &rc); //the journal is still there, the files do not hold the changes yet
+    failures += report("replaying the same journal twice", rc == DB_OK && markOf(db, 1000001) == 77.0f &&
+                                                           db_count(db) == 20);
+    db_destroy(db);
+
+    FILE *fp = fopen(journalPath, "a"); //a block cut off before its COMMIT
+    fprintf(fp, "BEGIN 1\nFILE\t0\t%s\nU\t0\t1000003\tStudent Number\tComputer Science\t12.00\n", dataPath);
+    fclose(fp);
+    db = reopen(both, &rc);
+    db_txn_stats(db, &stats);
+    failures += report("torn block is ignored", rc == DB_OK && stats.recovered == 1 && markOf(db, 1000003) == 50.0f &&
+                                                markOf(db, 1000001) == 77.0f);
+    db_destroy(db);
+
+    db = reopen(swapped, &rc);
+    failures += report("files opened in another order are refused", rc == DB_ERR_JOURNAL_MISMATCH);
+    db_destroy(db);
+    db = reopen(dataPath, &rc);
+    failures += report("file missing from the OPEN is refused", rc == DB_ERR_JOURNAL_MISMATCH);
+    db_destroy(db);
+
+    db = db_create(NULL);
+    rc = db ? db_open_lazy(db, both) : DB_ERR_NO_MEMORY; //it would show the rows from before the commits
+    failures += report("OPEN LAZY refuses a pending journal", rc == DB_ERR_JOURNAL_PENDING);
+    db_destroy(db);
+
+    db = reopen(both, &rc);
+    if (rc == DB_OK) rc = db_save(db);
+    db_destroy(db);
+    db = reopen(both, &rc);
+    failures += report("SAVE empties the journal", rc == DB_OK && fileSize(journalPath) == 0 &&
+                                                   markOf(db, 1000001) == 77.0f && db_count(db) == 20);
+    db_destroy(db);
+
+    added.id = 1000500; //committed, then deleted outside the transaction
+    db = reopen(both, &rc);
+    db_begin(db);
+    db_insert(db, 0, &added);
+    db_commit(db);
+    db_delete(db, 1000500);
+    db_set_path(db, 1, "no_such_dir/bench_txn_b.txt"); //the second file fails, the first one is still replaced
+    int saved = db_save(db);
+    db_destroy(db);
+    db = reopen(both, &rc);
+    failures += report("replay keeps a later plain change", saved != DB_OK && rc == DB_OK && !db_query(db, 1000500));
+    db_destroy(db);
+
+    remove(dataPath);
+    remove(otherPath);
+    remove(journalPath);
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    size_t rows = (argc > 1) ? (size_t)atoi(argv[1]) : 100000;
+    size_t changes = (argc > 2) ? (size_t)atoi(argv[2]) : 20000;
+    const size_t batches[] = {0, 1, 10, 100, 1000, 10000};  // 0 runs the changes without a transaction
+    int nextId = 2000000;
+
+    FILE *fp = fopen(dataPath, "w");
+    if (!fp) {
+        perror(dataPath);
+        return 1;
+    }
+    fprintf(fp, "ID\tName\tProgramme\tMark\n");
+    for (size_t i = 0; i < rows; i++)
+        fprintf(fp, "%d\tStudent Number\tComputer Science\t%.1f\n", 1000000 + (int)i, 1.0 + (double)(i % 991) / 10.0);
+    fclose(fp);
+    remove(journalPath);
+
+    Database *db = db_create(NULL);
+    if (!db || db_open(db, dataPath) != DB_OK) {
+        perror("open");
+        return 1;
+    }
+
+    printf("%zu rows, up to %zu changes per run\n", rows, changes);
+    printf("%8s %8s %9s %12s %12s %12s\n", "Batch", "Changes", "Commits", "Wall (ms)", "us/change", "Journal KB");
+    for (size_t b = 0; b < sizeof batches / sizeof batches[0]; b++) {
+        size_t batch = batches[b];
+        size_t n = changes;
+        if (batch && n > batch * 500) n = batch * 500; //every commit waits for the disk, keep the small batches short
+        int failed = 0;
+        size_t commits = 0;
+
+        double start = now();
+        for (size_t done = 0; done < n && !failed;) {
+            if (batch && db_begin(db) != DB_OK) failed = 1;
+            size_t size = batch ? batch : n;
+            for (size_t i = 0; i < size && done < n && !failed; i++, done++)
+                if (randomChange(db, rows, &nextId) != DB_OK) failed = 1;
+            if (batch && !failed) {
+                if (db_commit(db) != DB_OK) failed = 1;
+                commits++;
+            }
+        }
+        double elapsed = now() - start;
+        long journal = fileSize(journalPath);
+
+        if (batch) printf("%8zu", batch);
+        else printf("%8s", "none");
+        printf(" %8zu %9zu %12.1f %12.2f %12ld%s\n", n, commits, elapsed * 1000.0, elapsed * 1e6 / (double)n,
+               journal / 1024, failed ? "  FAILED" : "");
+        if (db_save(db) != DB_OK) { //the file holds everything, so the next run starts with an empty journal
+            perror("save");
+            return 1;
+        }
+    }
+
+    db_destroy(db);
+    remove(dataPath);
+    remove(journalPath);
+
+    printf("\n");
+    return checkRecovery() ? 1 : 0;
+}
@@ -1,7 +1,14 @@
-#ifndef DATABASE_H  
+#ifndef DATABASE_H
 #define DATABASE_H  // header used to declare shared types and functions
-#define MAX_RECORDS 100  // maximum number of student records
+#define MAX_SHARDS 16  // maximum number of files opened together
 #define MAX_STR_LEN 50  // maximum length of strings
+#define LAZY_CACHE_SIZE 64  // decoded rows kept in memory by OPEN LAZY
+#define MAX_CHECKPOINTS 8  // named checkpoints tracked by EXPORT CHANGES
+#define DEFAULT_CHECKPOINT "default"  // checkpoint used when EXPORT CHANGES is not given a name
+#define VIEW_REPAIR_LIMIT 32  // changes a cached sort order is repaired for before it is sorted again
+#define CHUNK_ROWS 256  // rows per storage chunk, the unit an autosave snapshot shares and a mutation copies
+#define NAME_MERGE_LIMIT 1024  // names added to the FIND index before they are merged into its sorted order
+#define FIND_LIMIT 20  // best matches FIND NAME shows
 
 #include <stddef.h>
 
@@ -27,6 +34,12 @@ typedef enum {
     CMD_EXIT,
     CMD_SUMMARY,
     CMD_EXPORT,
+    CMD_STATS,
+    CMD_AUTOSAVE,
+    CMD_BEGIN,
+    CMD_COMMIT,
+    CMD_ROLLBACK,
+    CMD_FIND,
     CMD_UNKNOWN
 } CommandType;
 
@@ -37,29 +50,152 @@ typedef enum {
     SORT_GRADE,
     SORT_NAME,
     SORT_PROGRAMME,
+    SORT_FIELD_COUNT  // number of sort fields, not a field itself
 } SortField;
 
-// internal storage owned by database.c
-extern Student records[MAX_RECORDS];
-extern int recordCount;
-
-// existing operations
-int openDatabase(const char *path);  // open database function
-int queryRecord(int id);  // query record function
-int deleteRecord(int id);  // delete record function
-int saveDatabase(const char *path);  // save database function
-int isValidProgramme(const char* programme);  // validate programme
-int exportToCSV(const char *path);  // export to CSV
-void showAll();  // show all records function
-void updateRecord(int id);  // update record function
-void insertRecord(void);   // insert record function
-void showSummary();  // show summary statistics
-void sortStudents(SortField field, int ascending);  // sorting function
+// sorted view cache counters
+typedef struct {
+    unsigned long hits;  // SHOW ALL SORT BY served without sorting
+    unsigned long misses;  // full sorts
+    unsigned long repairs;  // views patched after a few changes
+} ViewStats;
+
+// background autosave policy and counters
+typedef struct {
+    int enabled;  // 1 while the autosave thread is running
+    unsigned seconds, mutations;  // save every N seconds or every N mutations, 0 disables that trigger
+    unsigned long snapshots;  // snapshots written
+    unsigned long failures;  // snapshots that could not be written, the previous file is kept
+    double lastPauseUs, maxPauseUs;  // time mutations were blocked while the writer held the database
+    double lastWriteMs;  // time the last snapshot took to write, sync and rename
+    size_t lastBytes;  // bytes written by the last snapshot
+    unsigned long long totalBytes;  // bytes written by every snapshot
+} AutosaveStats;
+
+// transaction counters
+typedef struct {
+    int open;  // 1 between db_begin() and db_commit() or db_rollback()
+    size_t pending;  // IDs changed by the open transaction
+    unsigned long commits, rollbacks;
+    unsigned long recovered;  // committed transactions replayed from the journal by the last OPEN
+    size_t lastChanges;  // records applied by the last commit
+    double lastCommitMs;  // time the last commit took, including the journal sync
+} TxnStats;
+
+// change types recorded for EXPORT CHANGES
+typedef enum {
+    CHANGE_INSERT,
+    CHANGE_UPDATE,
+    CHANGE_DELETE,
+} ChangeOp;
+
+// result codes of the handle API, every failure is negative
+typedef enum {
+    DB_OK = 0,
+    DB_ERR_IO = -1,  // file could not be read or written, errno holds the reason
+    DB_ERR_NO_MEMORY = -2,
+    DB_ERR_NOT_FOUND = -3,  // no record with that ID
+    DB_ERR_DUPLICATE = -4,  // ID already exists
+    DB_ERR_INVALID_ID = -5,  // ID must be 7 digits and cannot start with 0
+    DB_ERR_INVALID_NAME = -6,  // name must be letters and spaces only
+    DB_ERR_INVALID_PROGRAMME = -7,  // programme cannot be empty or contain control characters or quotes
+    DB_ERR_INVALID_MARK = -8,  // mark must be between 1 and 100
+    DB_ERR_READ_ONLY = -9,  // database was opened lazily
+    DB_ERR_NO_PATH = -10,  // a shard has no file to save to
+    DB_ERR_TOO_MANY_FILES = -11,  // more than MAX_SHARDS files
+    DB_ERR_TOO_MANY_CHECKPOINTS = -12,  // more than MAX_CHECKPOINTS names
+    DB_ERR_LOG_INCOMPLETE = -13,  // a change could not be recorded, a full EXPORT is needed
+    DB_ERR_INVALID_ARGUMENT = -14,
+    DB_ERR_IN_TRANSACTION = -15,  // a transaction is open, COMMIT or ROLLBACK it first
+    DB_ERR_NO_TRANSACTION = -16,  // COMMIT or ROLLBACK without BEGIN
+    DB_ERR_JOURNAL_MISMATCH = -17,  // the journal left by an earlier session was written for other files or another order
+    DB_ERR_JOURNAL_PENDING = -18  // OPEN LAZY found a journal that OPEN has to replay and SAVE first
+} DbError;
+
+// allocation hooks, NULL members fall back to malloc, realloc and free
+// they may be called from the worker threads of one handle at the same time, never from other handles
+typedef struct {
+    void *(*alloc)(void *ctx, size_t size);
+    void *(*resize)(void *ctx, void *ptr, size_t size);
+    void (*release)(void *ctx, void *ptr);
+    void *ctx;  // passed back to every hook
+} DbAllocator;
+
+// summary statistics computed by db_summary()
+typedef struct {
+    size_t count;  // number of records
+    double average;  // average mark
+    float high, low;  // highest and lowest mark
+    char highName[MAX_STR_LEN], lowName[MAX_STR_LEN];  // students holding them
+    int gradeCounts[5];  // number of A, B, C, D and F grades
+} DbSummary;
+
+// opaque database handle, holds every open file and cache, nothing is shared between handles
+typedef struct Database Database;
+
+// called for every record in the current order, return non-zero to stop early
+typedef int (*DbVisitor)(const Student *s, void *ctx);
+
+// lifecycle
+Database *db_create(const DbAllocator *allocator);  // new empty database, NULL allocator uses malloc
+void db_destroy(Database *db);  // close every file and free the handle
+int db_open(Database *db, const char *paths);  // open a comma separated list of files or wildcard patterns, one shard per file
+int db_open_lazy(Database *db, const char *paths);  // map the files and index IDs only, rows are decoded on demand
+void db_close(Database *db);  // free every shard, the handle stays usable
+int db_is_lazy(const Database *db);  // 1 if the database is lazily opened (read-only)
+size_t db_duplicate_count(const Database *db);  // rows whose ID an earlier row holds, found by the last open
+
+// records
+const Student *db_query(Database *db, int id);  // NULL if no record has that ID, valid until the next mutation
+long db_find_name(Database *db, const char *text, size_t limit, DbVisitor visit, void *ctx);  // case-insensitive name search, returns matches visited or an error
+int db_insert(Database *db, size_t shard, const Student *s);  // add a record to a shard, grade is calculated
+int db_update(Database *db, const Student *s);  // replace the record with the same ID, grade is recalculated
+int db_delete(Database *db, int id);  // remove the record with that ID
+
+// iteration, in lazy mode rows are decoded into a cache slot, so the pointer is only valid until LAZY_CACHE_SIZE other rows are fetched
+size_t db_count(const Database *db);
+const Student *db_get(Database *db, size_t idx);  // record at a position in file order
+int db_foreach(Database *db, DbVisitor visit, void *ctx);  // every record in the current order
+int db_sort(Database *db, SortField field, int ascending);  // later iteration, EXPORT and SAVE follow this order, DB_ERR_READ_ONLY in lazy mode because sorting would need every row in memory
+int db_summary(Database *db, DbSummary *out);  // totals, highest, lowest and grade distribution
+
+// files
+int db_save(Database *db);  // save every shard back to its own source file
+int db_save_as(Database *db, const char *path);  // save every shard merged into one file
+int db_set_path(Database *db, size_t shard, const char *path);  // set the file a shard is saved to
+int db_export_csv(Database *db, const char *path);  // export to CSV
+long db_export_changes(Database *db, const char *path, const char *checkpoint);  // export rows changed since a checkpoint, returns rows written or an error
+// a checkpoint has no baseline until a db_export_csv() after the open, DB_ERR_LOG_INCOMPLETE is returned until then
+
+// background autosave, a writer thread saves a point-in-time snapshot of every shard to a temp file and renames it over the source file
+int db_autosave_start(Database *db, unsigned seconds, unsigned mutations);  // restart the writer with a new policy
+void db_autosave_stop(Database *db);  // stop the writer, waits for a snapshot that is being written
+void db_autosave_stats(Database *db, AutosaveStats *out);  // policy, snapshot duration and bytes written
+
+// transactions, changes are buffered until db_commit() applies them together and journals them with one sync
+// the journal is "<first file>.journal", OPEN replays committed transactions left in it and SAVE empties it
+// every block names the files it changes, OPEN refuses a journal written for files that are not open or opened in another order
+// while the journal holds blocks, changes outside a transaction are journaled too, so replay never undoes them
+int db_begin(Database *db);  // start buffering inserts, updates and deletes, db_query() sees them, other reads do not until commit
+int db_commit(Database *db);  // apply every buffered change at once, nothing is applied and the transaction stays open on failure
+int db_rollback(Database *db);  // discard every buffered change
+void db_txn_stats(Database *db, TxnStats *out);  // open transaction and commit counters
+
+// shards and statistics
+size_t db_shard_count(const Database *db);  // number of files currently open
+const char *db_shard_path(const Database *db, size_t shard);  // source file of a shard
+size_t db_version(const Database *db);  // number of changes since the last open, kept after old changes are dropped from the log
+void db_view_stats(const Database *db, ViewStats *out);  // sorted view cache counters
+const char *db_strerror(int err);  // message for a DbError
+
+// helpers shared with the command line
+int isValidName(const char *name);  // letters and spaces only, not empty
+int isValidProgramme(const char* programme);  // validate programme code
+int isNumericString(const char *s);  // digits with at most one decimal point
+int isValidMark(float mark);  // between 1 and 100
+char getGrade(float mark);  // grade letter for a mark
+int compareStudents(const Student *a, const Student *b, SortField field, int ascending);  // sort order of two records
 void clean_path(const char *input, char *output, size_t out_size);  // clean path utility
 const char *fullProgramme(const char *code);  // convert to full programme name
 
-// read-only accessors for iteration
-size_t db_count(void);
-Student* db_get(size_t idx);
-
-#endif
\ No newline at end of file
+#endif
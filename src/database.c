@@ -1,14 +1,233 @@
-#include <stdio.h>  // for FILE, fopen, fclose, fgets, fprintf, perror
-#include <string.h>  // for strlen, strcmp, strcpy, strncpy, strncmp, sscanf, memmove
-#include <ctype.h>  // for isdigit, isalpha, toupper
-#include <stdlib.h>  // for atof
+#include <stdio.h>  // for FILE, fopen, fclose, fgets, fprintf, snprintf
+#include <string.h>  // for strlen, strcmp, strcpy, strncmp, strcspn, sscanf, memmove
+#include <ctype.h>  // for isdigit, isalpha, tolower
+#include <stdlib.h>  // for malloc, realloc, free, atoi
+#include <errno.h>  // for errno, ENOMEM
+#include <pthread.h>  // for pthread_create, pthread_join, pthread_mutex_lock, pthread_cond_timedwait
+#include <time.h>  // for clock_gettime
 #include "database.h"  // for function prototypes, Student struct, constants
 
+#ifdef _WIN32
+#include <windows.h>  // for CreateFileMapping, MapViewOfFile, MoveFileEx
+#include <io.h>  // for _commit, _chsize
+#else
+#include <fcntl.h>  // for open
+#include <glob.h>  // for glob, globfree
+#include <sys/mman.h>  // for mmap, munmap
+#include <sys/stat.h>  // for fstat
+#include <unistd.h>  // for close, fsync, ftruncate
+#endif
+
 // =====================================================
 // STORAGE
 // =====================================================
-Student records[MAX_RECORDS];  // default 100 records
-int recordCount = 0;  //record counter 
+typedef struct {
+    int id;         //student ID of the row
+    size_t offset;  //byte offset of the row's line inside the mapped file
+} RowIndex;
+
+typedef struct {
+    size_t row;            //index of the cached row
+    unsigned long stamp;   //last time this slot was used, smallest stamp gets evicted first
+    int used;              //0 if the slot is still empty
+    Student s;             //decoded row
+} CacheSlot;
+
+// fixed size block of materialised rows, the unit an autosave snapshot shares with the shard
+typedef struct RowChunk {
+    unsigned long epoch;  //snapshot number current when the chunk was created, older chunks are shared with a running snapshot
+    struct RowChunk *nextRetired;  //link in the list of replaced chunks freed once the snapshot is written
+    Student rows[CHUNK_ROWS];
+} RowChunk;
+
+// one shard per source file, each shard owns its rows and is only touched by one thread at a time
+typedef struct {
+    Database *db;  //handle the shard belongs to, gives the worker jobs its allocator
+    char path[512];  //cleaned path of the source file, empty if the rows were only inserted
+    RowChunk **chunks;  //materialised rows (full OPEN), CHUNK_ROWS per chunk
+    size_t count;  //number of rows in this shard
+    size_t chunkCap;  //allocated capacity of chunks
+    int lazy;  //1 if the rows still live in the mapped file (OPEN LAZY)
+    const char *mapBase;  //start of the mapped file
+    size_t mapSize;  //size of the mapped file in bytes
+#ifdef _WIN32
+    HANDLE mapFile, mapHandle;
+#endif
+    RowIndex *rowIndex;  //one entry per row in file order (lazy only)
+    unsigned *idOrder;  //row numbers sorted by ID, equal IDs in file order (lazy only), so QUERY can binary search
+    CacheSlot cache[LAZY_CACHE_SIZE];  //bounded LRU cache of decoded rows (lazy only)
+    unsigned long cacheClock;  //incremented on every cache access
+} Shard;
+
+#define NO_NAME_ENTRY ((unsigned)-1)
+
+// entry of the global ID index, maps a student ID to the shard and row holding it; only a full OPEN builds it
+typedef struct {
+    int id;
+    int used;
+    size_t shard;
+    size_t row;
+    unsigned nameEntry;  //entry of the current name in the name index, NO_NAME_ENTRY until it is indexed
+} IdSlot;
+
+#define NAME_GRAMS (28 * 28 * 28)  //trigrams over a-z, space and one code for every other character
+#define NAME_RECENT_SHARE 32  //the recent run of a word list is merged into the large one when it outgrows 1/32 of it
+#define JOURNAL_TRIM_ROUNDS 4  //times the autosave writer copies newly committed blocks before it leaves the journal whole
+
+// one indexed name, entries are only appended, so a renamed or deleted student leaves a stale one behind
+typedef struct {
+    int id;
+    unsigned key;  //offset of the case-folded name in the key arena
+} NameEntry;
+
+// word of an indexed name, the unit FIND NAME matches prefixes against
+typedef struct {
+    unsigned entry;  //name entry the word belongs to
+    unsigned key;  //offset of the word in the key arena, the key runs to the end of the name
+} WordRef;
+
+// words in two runs in key order, a large one and a recent one, words added since the last merge are kept unsorted at the end
+// new words are merged into the recent run, which is merged into the large one once it outgrows a fraction of it
+typedef struct {
+    WordRef *refs;
+    size_t count, cap;
+    size_t sorted;  //refs before this are in key order
+    size_t recent;  //refs from sorted up to this are in key order as well
+} WordList;
+
+typedef struct {
+    unsigned *entries;  //name entries containing the trigram, ascending
+    size_t count, cap;
+} Postings;
+
+// case-folded name index behind FIND NAME, built by OPEN and kept up to date by every change after it
+// OPEN LAZY leaves it to the first search, building it would decode every row of the mapped files
+typedef struct {
+    char *keys;  //case-folded names, each null terminated
+    size_t keyBytes, keyCap;
+    NameEntry *entries;
+    size_t count, cap;
+    size_t live;  //entries still current, the rest belong to renamed or deleted students
+    WordList firstWords;  //first word of every name, so a prefix search finds whole names
+    WordList laterWords;  //every later word, so a search also finds surnames
+    Postings grams[NAME_GRAMS];  //substring candidates by trigram
+} NameIndex;
+
+// position of a row, kept by views instead of its ID so rows sharing a duplicate ID stay apart
+typedef struct {
+    unsigned shard, row;
+} RowRef;
+
+// cached sort order, a permutation of every row for one (field, direction)
+typedef struct {
+    RowRef *refs;  //rows in sorted order
+    size_t count, cap;
+    size_t version;  //db_version() the order was last brought up to date with
+    int built;  //0 until the first sort with this field and direction
+} SortView;
+
+// change log used by EXPORT CHANGES, entry i has change sequence number changeBase + i
+typedef struct {
+    int id;  //student ID that changed
+    ChangeOp op;  //what happened to it
+    unsigned shard, row;  //where the row was at that moment, a delete shifts every later row of its shard down one
+} ChangeEntry;
+
+typedef struct {
+    char name[MAX_STR_LEN];  //checkpoint name given to EXPORT CHANGES
+    size_t seq;  //number of changes already exported under this name
+    int partial;  //1 until a full EXPORT gives the name a baseline in this session, EXPORT CHANGES refuses it until then
+} Checkpoint;
+
+// change of one student ID buffered by a transaction, the net result of every INSERT, UPDATE and DELETE of it
+typedef struct {
+    int id;
+    int inTable;  //1 if the ID is in the table outside the transaction
+    int present;  //1 if the ID exists once the transaction commits
+    int op;  //ChangeOp the commit applies, -1 if the table already holds the record
+    size_t shard;  //shard a new record goes into
+    Student rec;  //record as of the last buffered change
+} PendingChange;
+
+typedef struct {
+    int open;  //1 between db_begin() and the end of the transaction
+    PendingChange *changes;  //one per ID in order of first change, so the commit applies and journals them in a stable order
+    size_t count, cap;
+    size_t *slots;  //open addressing table of change index + 1 keyed by student ID, 0 is empty, at most half full
+    size_t slotCap;
+} Transaction;
+
+// background writer state, guarded by the database lock
+typedef struct {
+    pthread_t thread;
+    pthread_cond_t wake;  //signalled when enough mutations piled up or the writer is stopped
+    int stop;  //asks the writer to finish
+    AutosaveStats stats;  //policy and counters, stats.enabled while the writer runs
+} Autosave;
+
+// everything one database owns, handles share nothing so each can be used from its own thread
+struct Database {
+    DbAllocator mem;  //allocation hooks, every member is set
+
+    Shard *shards;  //MAX_SHARDS shards, allocated with the handle
+    size_t shardCount;  //number of shards in use
+    int lazyMode;  //1 while the database is opened with OPEN LAZY
+    size_t duplicates;  //rows whose ID an earlier row holds, found by the last open and fewer as such rows are deleted
+
+    IdSlot *idIndex;  //open addressing hash table over every shard, OPEN LAZY searches each shard's idOrder instead
+    size_t idCap, idUsed;  //capacity (power of two) and number of entries
+
+    SortView views[SORT_FIELD_COUNT][2];  //indexed by field and ascending
+    int activeField, activeAscending;  //order iteration, EXPORT and SAVE follow, -1 for file order
+    ViewStats viewStats;
+
+    ChangeEntry *changeLog;  //changes no checkpoint or repairable view has moved past yet
+    size_t changeCount, changeCap;
+    size_t changeBase;  //sequence number of changeLog[0], the changes before it were dropped
+    int changeLogFailed;  //1 if a change could not be recorded since the last open
+    Checkpoint checkpoints[MAX_CHECKPOINTS];
+    size_t checkpointCount;
+
+    pthread_mutex_t lock;  //held by mutations and by the autosave writer while it takes or ends a snapshot
+    pthread_mutex_t fileLock;  //serialises SAVE and autosave writing the same files, always taken before lock
+    size_t unsaved;  //mutations since the last autosave snapshot
+    unsigned long snapEpoch;  //number of snapshots taken
+    int snapActive;  //1 while the writer is reading the chunks of snapshot snapEpoch
+    RowChunk *retired;  //chunks replaced while a snapshot was active
+    Autosave autosave;
+
+    NameIndex *names;  //NULL after OPEN LAZY or before any OPEN until the first FIND NAME, or if it ran out of memory
+
+    Transaction txn;
+    TxnStats txnStats;
+    size_t journalBytes;  //size of the journal after the last block this handle wrote or replayed
+    unsigned long journalGen;  //changed whenever the journal is emptied or trimmed, so older offsets are not reused
+};
+
+// =====================================================
+// Helper: Allocation through the handle's hooks
+// =====================================================
+static void *stdAlloc(void *ctx, size_t size) { (void)ctx; return malloc(size); }
+static void *stdResize(void *ctx, void *ptr, size_t size) { (void)ctx; return realloc(ptr, size); }
+static void stdRelease(void *ctx, void *ptr) { (void)ctx; free(ptr); }
+
+static void *dbAlloc(Database *db, size_t size) {
+    return db->mem.alloc(db->mem.ctx, size);
+}
+
+static void *dbResize(Database *db, void *ptr, size_t size) {
+    return db->mem.resize(db->mem.ctx, ptr, size);
+}
+
+static void dbFree(Database *db, void *ptr) {
+    if (ptr) db->mem.release(db->mem.ctx, ptr);
+}
+
+static void *dbZalloc(Database *db, size_t size) {
+    void *p = dbAlloc(db, size);
+    if (p) memset(p, 0, size);
+    return p;
+}
 
 // =====================================================
 // Helper: Cleans user's input path
@@ -17,9 +236,9 @@ void clean_path(const char *input, char *output, size_t out_size) {
     // if invalid input or output or zero size, exit
     if (!input || !output || out_size == 0) return;
 
-    // safely copies input 
+    // safely copies input
     snprintf(output, out_size, "%s", input);
-    
+
     size_t len = strlen(output);
     // removes surrounding quotation marks " or ' if present
     if (len > 1 && ((output[0] == '"' || output[0] == '\'') && output[len - 1] == output[0])) {
@@ -43,15 +262,10 @@ char getGrade(float mark) {
 // Helper: Validate Name
 // =====================================================
 int isValidName(const char *name) {
-    if (!name || name[0] == '\0') { //if empty input is detected
-        printf("Invalid name. Name cannot be empty.\n");
-        return 0;
-    }
+    if (!name || name[0] == '\0') return 0; //if empty input is detected
     for (int i = 0; name[i]; i++) {
-        if (!isalpha((unsigned char)name[i]) && name[i] != ' ') { //if anything else other than letters and spaces are detected
-            printf("Invalid name. Only letters and spaces allowed.\n");
+        if (!isalpha((unsigned char)name[i]) && name[i] != ' ') //if anything else other than letters and spaces are detected
             return 0;
-        }
     }
     return 1; //passed all checks
 }
@@ -66,7 +280,6 @@ int isValidProgramme(const char *programme) {
         if (strcmp(programme, valid[i]) == 0)
             return 1;
     }
-    printf("Invalid programme. Use CS, CE, EE, AI, or DSC and the field cannot be empty.\n");
     return 0;
 }
 
@@ -103,7 +316,7 @@ const char *fullProgramme(const char *code) {
 // =====================================================
 int isNumericString(const char *s) {
     if (!s || s[0] == '\0') return 0; //reject empty input
-    int dotCount = 0; //track how many decimals there are 
+    int dotCount = 0; //track how many decimals there are
     for (int i = 0; s[i]; i++) {
         if (isdigit((unsigned char)s[i])) continue; //if the input is from 0-9, continue
         if (s[i] == '.') { //only allow one decimal point
@@ -120,416 +333,2669 @@ int isNumericString(const char *s) {
 // Helper: Validate Mark Range
 // =====================================================
 int isValidMark(float mark) {
-    if (mark < 1.0f || mark > 100.0f) { //make sure its from 1 to 100 only
-        printf("Invalid mark. Must be between 1 and 100.\n");
-        return 0;
+    return mark >= 1.0f && mark <= 100.0f; //make sure its from 1 to 100 only
+}
+
+// =====================================================
+// Helper: Error messages
+// =====================================================
+const char *db_strerror(int err) {
+    switch (err) {
+        case DB_OK: return "Success";
+        case DB_ERR_IO: return "File could not be read or written";
+        case DB_ERR_NO_MEMORY: return "Out of memory";
+        case DB_ERR_NOT_FOUND: return "No record found with that ID";
+        case DB_ERR_DUPLICATE: return "ID already exists";
+        case DB_ERR_INVALID_ID: return "Invalid ID length. Must be 7 digits and cannot start with 0";
+        case DB_ERR_INVALID_NAME: return "Invalid name. Only letters and spaces allowed";
+        case DB_ERR_INVALID_PROGRAMME: return "Invalid programme. The field cannot be empty or contain tabs, line breaks or quotes";
+        case DB_ERR_INVALID_MARK: return "Invalid mark. Must be between 1 and 100";
+        case DB_ERR_READ_ONLY: return "Database was opened with OPEN LAZY and is read-only. Use OPEN to modify it";
+        case DB_ERR_NO_PATH: return "No file path specified";
+        case DB_ERR_TOO_MANY_FILES: return "Too many files, at most 16 can be opened together";
+        case DB_ERR_TOO_MANY_CHECKPOINTS: return "Too many checkpoints";
+        case DB_ERR_LOG_INCOMPLETE: return "Change log is incomplete, use a full EXPORT first";
+        case DB_ERR_INVALID_ARGUMENT: return "Invalid argument";
+        case DB_ERR_IN_TRANSACTION: return "A transaction is open, COMMIT or ROLLBACK it first";
+        case DB_ERR_NO_TRANSACTION: return "No transaction is open, use BEGIN first";
+        case DB_ERR_JOURNAL_PENDING: return "Committed transactions are waiting in a journal, OPEN the files and SAVE before using OPEN LAZY";
+        case DB_ERR_JOURNAL_MISMATCH: return "A journal of unsaved transactions names other files, OPEN the files it was written for in the same order";
+        default: return "Unknown error";
     }
+}
+
+// =====================================================
+// Helper: Parse one tab separated record line
+// =====================================================
+static int parseRecordLine(const char *line, Student *s) {
+    if (sscanf(line, "%d\t%49[^\t]\t%49[^\t]\t%f", &s->id, s->name, s->programme, &s->mark) != 4)
+        return 0; //line is not a complete record
+    //calls fullProgramme to convert short code to full name, names that are already full are kept as they are
+    const char *full = fullProgramme(s->programme);
+    if (full != s->programme) strcpy(s->programme, full);
+    s->grade = getGrade(s->mark);
     return 1;
 }
 
 // =====================================================
-// OPEN DATABASE (.txt)
+// Helper: Flush a file to disk
 // =====================================================
-int openDatabase(const char *path) {
-    char clean[512], line[512];
-    clean_path(path, clean, sizeof clean); //remove surrounding quotes or extra spaces
+// returns 0 or an errno value, the file stays open
+static int syncFile(FILE *fp) {
+    if (fflush(fp) != 0) return errno ? errno : EIO;
+#ifdef _WIN32
+    if (_commit(_fileno(fp)) != 0) return errno ? errno : EIO;
+#else
+    if (fsync(fileno(fp)) != 0) return errno ? errno : EIO;
+#endif
+    return 0;
+}
 
-    FILE *fp = fopen(clean, "r");
-    if (!fp) return -1; //return -1 if the file cant be opened
+static double elapsedUs(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * 1e6 + (to->tv_nsec - from->tv_nsec) / 1e3;
+}
 
-    // Skip header until "ID"
-    while (fgets(line, sizeof(line), fp)) {
-        char *p = line;
-        while (*p == ' ' || *p == '\t') p++; //skip leading spaces or tabs
-        if (strncmp(p, "ID", 2) == 0) break; //stop when a line starting with ID is found
+// =====================================================
+// Helper: Shards
+// =====================================================
+// Helper: materialised row of a shard
+static Student *rowAt(const Shard *sh, size_t row) {
+    return &sh->chunks[row / CHUNK_ROWS]->rows[row % CHUNK_ROWS];
+}
+
+// Helper: 1 if the running autosave snapshot may still read this chunk, the database lock must be held
+static int chunkShared(const Database *db, const RowChunk *c) {
+    return db->snapActive && c->epoch < db->snapEpoch;
+}
+
+// Helper: let go of a chunk, one the snapshot is still reading is freed after it was written; the database lock must be held
+static void releaseChunk(Database *db, RowChunk *c) {
+    if (chunkShared(db, c)) {
+        c->nextRetired = db->retired;
+        db->retired = c;
+    } else {
+        dbFree(db, c);
     }
+}
 
-    recordCount = 0;
-    while (recordCount < MAX_RECORDS && fgets(line, sizeof(line), fp)) { //read each student record line by line
-        char *p = line;
-        while (*p == ' ' || *p == '\t') p++; //skip whitespace at the start
-        if (!isdigit((unsigned char)*p)) continue; //if the line does not start with a digit, skip it
+// Helper: copy every chunk holding rows first..last that the snapshot still shares, so they can be written, returns 0 on success
+static int ownChunks(Shard *sh, size_t first, size_t last) {
+    Database *db = sh->db;
+    for (size_t c = first / CHUNK_ROWS; c <= last / CHUNK_ROWS; c++) {
+        if (!chunkShared(db, sh->chunks[c])) continue; //already private
+        RowChunk *copy = dbAlloc(db, sizeof *copy);
+        if (!copy) return -1;
+        memcpy(copy->rows, sh->chunks[c]->rows, sizeof copy->rows);
+        copy->epoch = db->snapEpoch;
+        releaseChunk(db, sh->chunks[c]); //the snapshot keeps reading the old one
+        sh->chunks[c] = copy;
+    }
+    return 0;
+}
 
-        Student s;
-        if (sscanf(line, "%d\t%49[^\t]\t%49[^\t]\t%f", &s.id, s.name, s.programme, &s.mark) == 4) {
-            //calls fullProgramme to convert short code to full name
-            strcpy(s.programme, fullProgramme(s.programme));
-            s.grade = getGrade(s.mark);
-            records[recordCount++] = s;
+// Helper: unmap a lazily opened shard and free everything it owns
+static void freeShard(Shard *sh) {
+    Database *db = sh->db;
+    if (sh->lazy && sh->mapBase) {
+#ifdef _WIN32
+        UnmapViewOfFile(sh->mapBase);
+        CloseHandle(sh->mapHandle);
+        CloseHandle(sh->mapFile);
+#else
+        munmap((void *)sh->mapBase, sh->mapSize);
+#endif
+    }
+    size_t chunks = sh->lazy ? 0 : (sh->count + CHUNK_ROWS - 1) / CHUNK_ROWS; //lazy rows live in the mapping
+    for (size_t i = 0; i < chunks; i++) releaseChunk(db, sh->chunks[i]); //a snapshot may still be writing some of them
+    dbFree(db, sh->chunks);
+    dbFree(db, sh->rowIndex);
+    dbFree(db, sh->idOrder);
+    memset(sh, 0, sizeof *sh);
+    sh->db = db;
+}
+
+// Helper: append a row to a materialised shard, new chunks are stamped with epoch, returns 0 on success
+// a published shard must first own its last chunk, see ownChunks()
+static int appendRow(Shard *sh, const Student *s, unsigned long epoch) {
+    size_t c = sh->count / CHUNK_ROWS;
+    if (sh->count % CHUNK_ROWS == 0) { //last chunk is full, start a new one
+        if (c == sh->chunkCap) { //grow the chunk table geometrically
+            size_t cap = sh->chunkCap ? sh->chunkCap * 2 : 4;
+            RowChunk **grown = dbResize(sh->db, sh->chunks, cap * sizeof *grown);
+            if (!grown) return -1;
+            sh->chunks = grown;
+            sh->chunkCap = cap;
         }
+        sh->chunks[c] = dbAlloc(sh->db, sizeof *sh->chunks[c]);
+        if (!sh->chunks[c]) return -1;
+        sh->chunks[c]->epoch = epoch;
     }
-    fclose(fp);
+    *rowAt(sh, sh->count++) = *s;
     return 0;
 }
-// =====================================================
-// QUERY
-// =====================================================
-int queryRecord(int id) {
-    for (int i = 0; i < recordCount; i++) { //prints the data associated with the ID
-        if (records[i].id == id) {
-            printf("\nRecord found:\n");
-            printf("ID\t: %d\n", records[i].id);
-            printf("Name\t: %s\n", records[i].name);
-            printf("Programme: %s\n", records[i].programme);
-            printf("Mark\t: %.2f\n", records[i].mark);
-            printf("Grade\t: %c\n", records[i].grade);
-            return i;
+
+// Helper: forget the last row, its chunk is released once it is empty
+static void dropLastRow(Shard *sh) {
+    sh->count--;
+    if (sh->count % CHUNK_ROWS == 0) releaseChunk(sh->db, sh->chunks[sh->count / CHUNK_ROWS]);
+}
+
+// Helper: allocate the chunks n more rows need up front, so writing them cannot fail, returns 0 on success
+// chunks left without rows are given back with trimChunks()
+static int reserveRows(Shard *sh, size_t n, unsigned long epoch) {
+    size_t have = (sh->count + CHUNK_ROWS - 1) / CHUNK_ROWS, need = (sh->count + n + CHUNK_ROWS - 1) / CHUNK_ROWS;
+    if (need > sh->chunkCap) {
+        size_t cap = sh->chunkCap ? sh->chunkCap * 2 : 4;
+        while (cap < need) cap *= 2;
+        RowChunk **grown = dbResize(sh->db, sh->chunks, cap * sizeof *grown);
+        if (!grown) return -1;
+        sh->chunks = grown;
+        sh->chunkCap = cap;
+    }
+    for (size_t c = have; c < need; c++) {
+        sh->chunks[c] = dbAlloc(sh->db, sizeof *sh->chunks[c]);
+        if (!sh->chunks[c]) {
+            while (c-- > have) dbFree(sh->db, sh->chunks[c]);
+            return -1;
         }
+        sh->chunks[c]->epoch = epoch;
     }
-    printf("\nNo record found with ID %d.\n", id);
-    return -1;
+    return 0;
+}
+
+// Helper: release the chunks past the last row that were needed for upto rows
+static void trimChunks(Shard *sh, size_t upto) {
+    for (size_t c = (sh->count + CHUNK_ROWS - 1) / CHUNK_ROWS; c < (upto + CHUNK_ROWS - 1) / CHUNK_ROWS; c++)
+        releaseChunk(sh->db, sh->chunks[c]);
+}
+
+// Helper: copy the line starting at offset out of the mapping, always null terminated
+static const char *mappedLine(const Shard *sh, size_t offset, size_t *next, char *buf, size_t n) {
+    size_t end = offset;
+    while (end < sh->mapSize && sh->mapBase[end] != '\n') end++; //find the end of this line
+    size_t len = end - offset;
+    if (len >= n) len = n - 1; //overlong lines get cut like fgets would
+    memcpy(buf, sh->mapBase + offset, len);
+    buf[len] = '\0';
+    if (next) *next = (end < sh->mapSize) ? end + 1 : sh->mapSize; //start of the following line
+    return buf;
+}
+
+// Helper: decode a row through the shard's LRU cache, the pointer stays valid until LAZY_CACHE_SIZE other rows are decoded
+static Student *lazyRow(Shard *sh, size_t row) {
+    CacheSlot *victim = &sh->cache[0];
+    sh->cacheClock++;
+    for (int i = 0; i < LAZY_CACHE_SIZE; i++) {
+        CacheSlot *slot = &sh->cache[i];
+        if (slot->used && slot->row == row) { //cache hit
+            slot->stamp = sh->cacheClock;
+            return &slot->s;
+        }
+        if (!slot->used || (victim->used && slot->stamp < victim->stamp))
+            victim = slot; //prefer empty slots, otherwise the least recently used one
+    }
+
+    char line[512];
+    mappedLine(sh, sh->rowIndex[row].offset, NULL, line, sizeof line);
+    if (!parseRecordLine(line, &victim->s)) return NULL; //file changed underneath the mapping
+    victim->row = row;
+    victim->used = 1;
+    victim->stamp = sh->cacheClock;
+    return &victim->s;
+}
+
+// Helper: row of a shard, decoded on demand if the shard is lazy
+static Student *shardRow(Shard *sh, size_t row) {
+    return sh->lazy ? lazyRow(sh, row) : rowAt(sh, row);
+}
+
+// Helper: student ID of a row without decoding it
+static int shardRowId(const Shard *sh, size_t row) {
+    return sh->lazy ? sh->rowIndex[row].id : rowAt(sh, row)->id;
 }
 
 // =====================================================
-// UPDATE
+// Helper: Run one job per shard in parallel
 // =====================================================
-void updateRecord(int id) {
-    int index = queryRecord(id); //checks if the student exists, queryRecord() will print if it does and return its index. if ID is not found, index = -1
-    if (index == -1) return;
-    char buffer[64];
-
-    // NAME
-    printf("\nEnter new name (Enter to keep. Letters and spaces only allowed): ");
-    fgets(buffer, sizeof(buffer), stdin);
-    buffer[strcspn(buffer, "\n")] = '\0'; //remove newline characters
+typedef void (*ShardJob)(Shard *sh, void *arg);
 
-    if (buffer[0] != '\0' && isValidName(buffer)) //only update if theres an input, empty = keep old record
-        strcpy(records[index].name, buffer);
+typedef struct {
+    ShardJob job;
+    Shard *shard;
+    void *arg;
+} JobArgs;
+
+static void *runJob(void *p) {
+    JobArgs *a = p;
+    a->job(a->shard, a->arg);
+    return NULL;
+}
 
-    // PROGRAMME
-    printf("Enter new programme (Enter to keep. CS,CE,EE,AI,DSC only allowed): ");
-    fgets(buffer, sizeof(buffer), stdin);
-    buffer[strcspn(buffer, "\n")] = '\0';
+// calls job(&set[i], args + i * argSize) for every shard, each on its own thread
+// jobs must only touch their own shard and argument, so no locking is needed
+static void runParallel(Shard *set, size_t n, ShardJob job, void *args, size_t argSize) {
+    pthread_t threads[MAX_SHARDS];
+    JobArgs jobs[MAX_SHARDS];
+    int started[MAX_SHARDS];
 
-    if (buffer[0] != '\0' && isValidProgramme(buffer)) { //update if user entered something and programme is valid
-    strcpy(records[index].programme, fullProgramme(buffer)); //fullProgramme() converts 2-3 letter code to its full name
+    for (size_t i = 0; i < n; i++) {
+        jobs[i].job = job;
+        jobs[i].shard = &set[i];
+        jobs[i].arg = (char *)args + i * argSize;
+    }
+    if (n == 1) { //no point starting a thread for a single shard
+        runJob(&jobs[0]);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        started[i] = (pthread_create(&threads[i], NULL, runJob, &jobs[i]) == 0);
+        if (!started[i]) runJob(&jobs[i]); //fall back to running it here
     }
+    for (size_t i = 0; i < n; i++)
+        if (started[i]) pthread_join(threads[i], NULL);
+}
 
-    // MARK
-    printf("Enter new mark (Enter to keep. Within 1-100 only): ");
-    fgets(buffer, sizeof(buffer), stdin);
-    buffer[strcspn(buffer, "\n")] = '\0';
+// =====================================================
+// GLOBAL ID INDEX
+// =====================================================
+// Helper: slot an ID hashes to
+static size_t idHash(const Database *db, int id) {
+    return ((unsigned)id * 2654435761u) & (db->idCap - 1);
+}
 
-    if (buffer[0] != '\0') {
-        if (!isNumericString(buffer)) {
-            printf("Invalid mark. Must be numeric.\n");
-            return;
-        }
-        float m = atof(buffer); //convert string into float 
-        if (!isValidMark(m)) return; //check if its from 1-100 range
-        records[index].mark = m;
+// Helper: find the entry of an ID, NULL if the ID is not in any shard
+static IdSlot *idFind(const Database *db, int id) {
+    if (db->idCap == 0) return NULL;
+    for (size_t i = idHash(db, id); db->idIndex[i].used; i = (i + 1) & (db->idCap - 1)) //linear probing
+        if (db->idIndex[i].id == id) return &db->idIndex[i];
+    return NULL;
+}
+
+// Helper: first row of a lazy shard holding an ID, -1 if there is none
+static long lazyFindRow(const Shard *sh, int id) {
+    size_t lo = 0, hi = sh->count;
+    while (lo < hi) { //lower bound, so the first of equal IDs is found
+        size_t mid = lo + (hi - lo) / 2;
+        if (sh->rowIndex[sh->idOrder[mid]].id < id) lo = mid + 1;
+        else hi = mid;
     }
+    return (lo < sh->count && sh->rowIndex[sh->idOrder[lo]].id == id) ? (long)sh->idOrder[lo] : -1;
+}
 
-    records[index].grade = getGrade(records[index].mark); //recalculate grade after mark update
-    printf("\nRecord updated successfully!\n");
+// Helper: shard and row holding an ID, returns 0 if no shard holds it
+// a lazy database searches the shards in order, so the first copy of a duplicate ID wins like in the ID index
+static int locateId(const Database *db, int id, size_t *shard, size_t *row) {
+    if (!db->lazyMode) {
+        IdSlot *slot = idFind(db, id);
+        if (!slot) return 0;
+        *shard = slot->shard;
+        *row = slot->row;
+        return 1;
+    }
+    for (size_t s = 0; s < db->shardCount; s++) {
+        long r = lazyFindRow(&db->shards[s], id);
+        if (r < 0) continue;
+        *shard = s;
+        *row = (size_t)r;
+        return 1;
+    }
+    return 0;
 }
 
-// =====================================================
-// INSERT
-// =====================================================
-void insertRecord(void) {
-    if (recordCount >= MAX_RECORDS) { //stop insertion if database is full
-        printf("Cannot insert: database full.\n");
-        return;
+// Helper: grow the table so n entries fit without another rehash, returns 0 on success
+static int idReserve(Database *db, size_t n) {
+    if (n * 2 <= db->idCap) return 0; //keep the table at most half full
+    size_t oldCap = db->idCap;
+    IdSlot *old = db->idIndex;
+    size_t cap = db->idCap ? db->idCap * 2 : 256;
+    while (n * 2 > cap) cap *= 2;
+    IdSlot *grown = dbZalloc(db, cap * sizeof *grown);
+    if (!grown) return -1;
+    db->idIndex = grown;
+    db->idCap = cap;
+    for (size_t i = 0; i < oldCap; i++) { //rehash every existing entry
+        if (!old[i].used) continue;
+        size_t j = idHash(db, old[i].id);
+        while (db->idIndex[j].used) j = (j + 1) & (db->idCap - 1);
+        db->idIndex[j] = old[i];
     }
+    dbFree(db, old);
+    return 0;
+}
 
-    Student s; //temporary student record used to store all new input 
-    char buf[64]; //input buffer for reading strings like ID and mark
+// Helper: add an ID, returns 1 if added, 0 if the ID already exists and -1 if out of memory
+static int idPut(Database *db, int id, size_t shard, size_t row) {
+    if (idReserve(db, db->idUsed + 1) != 0) return -1;
+
+    size_t i = idHash(db, id);
+    for (; db->idIndex[i].used; i = (i + 1) & (db->idCap - 1))
+        if (db->idIndex[i].id == id) return 0;
+    db->idIndex[i].id = id;
+    db->idIndex[i].used = 1;
+    db->idIndex[i].shard = shard;
+    db->idIndex[i].row = row;
+    db->idIndex[i].nameEntry = NO_NAME_ENTRY;
+    db->idUsed++;
+    return 1;
+}
 
-    // ID
-    printf("\nEnter new student ID (7 digits): ");
-    fgets(buf, sizeof(buf), stdin);
-    buf[strcspn(buf, "\n")] = '\0'; //remove newline
+// Helper: remove an ID, later entries of the same probe chain are shifted back so lookups still find them
+static void idRemove(Database *db, int id) {
+    IdSlot *slot = idFind(db, id);
+    if (!slot) return;
+    size_t hole = (size_t)(slot - db->idIndex);
+    for (size_t j = (hole + 1) & (db->idCap - 1); db->idIndex[j].used; j = (j + 1) & (db->idCap - 1)) {
+        size_t home = idHash(db, db->idIndex[j].id);
+        int stays = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (stays) continue; //entry is still reachable from its home slot
+        db->idIndex[hole] = db->idIndex[j];
+        hole = j;
+    }
+    db->idIndex[hole].used = 0;
+    db->idUsed--;
+}
 
-    if (buf[0] == '\0') { printf("ID cannot be empty.\n"); return; } //empty input check
-    for (int i = 0; buf[i]; i++) //ensure ID contains numeric input only
-        if (!isdigit((unsigned char)buf[i])) {
-            printf("ID must be numeric.\n");
-            return;
+// Helper: count the rows whose ID an earlier row already has, by k-way merging the ID order of every lazy shard
+static size_t countLazyDuplicates(const Database *db) {
+    size_t pos[MAX_SHARDS] = {0}, dups = 0;
+    int seen = 0, last = 0;
+    for (;;) { //take the smallest ID at the head of all shards
+        long best = -1;
+        for (size_t s = 0; s < db->shardCount; s++) {
+            const Shard *sh = &db->shards[s];
+            if (pos[s] < sh->count && (best < 0 || sh->rowIndex[sh->idOrder[pos[s]]].id <
+                                                   db->shards[best].rowIndex[db->shards[best].idOrder[pos[best]]].id))
+                best = (long)s;
         }
+        if (best < 0) return dups;
+        const Shard *sh = &db->shards[best];
+        int id = sh->rowIndex[sh->idOrder[pos[best]++]].id;
+        if (seen && id == last) dups++;
+        seen = 1;
+        last = id;
+    }
+}
 
-    s.id = atoi(buf); //convert string to integer once validated
-    if (s.id < 1000000 || s.id > 9999999) { //check that ID is exactly 7 digits and cannot start with 0
-        printf("Invalid ID length. Must be 7 digits and cannot start with 0.\n");
-        return;
+// Helper: rebuild the index over every shard, duplicate IDs are counted and the first one wins
+// a lazy database only counts them, its shards are searched through their own ID order
+static int rebuildIdIndex(Database *db) {
+    dbFree(db, db->idIndex);
+    db->idIndex = NULL;
+    db->idCap = db->idUsed = 0;
+    db->duplicates = 0;
+    if (db->lazyMode) {
+        db->duplicates = countLazyDuplicates(db);
+        return 0;
     }
-    for (int i = 0; i < recordCount; i++) { //prevent duplicate IDs
-        if (records[i].id == s.id) {
-            printf("ID already exists.\n");
-            return;
+    for (size_t s = 0; s < db->shardCount; s++) {
+        for (size_t r = 0; r < db->shards[s].count; r++) {
+            int added = idPut(db, shardRowId(&db->shards[s], r), s, r);
+            if (added < 0) return -1;
+            if (added == 0) db->duplicates++;
         }
     }
+    return 0;
+}
 
-    // NAME
-    printf("Enter name: ");
-    fgets(s.name, sizeof(s.name), stdin);
-    s.name[strcspn(s.name, "\n")] = '\0';
-    if (!isValidName(s.name)) return; //validates that name contains letters and spaces plus its not empty
-
-    // PROGRAMME
-    printf("Enter programme (CS/CE/EE/AI/DSC): ");
-    fgets(s.programme, sizeof(s.programme), stdin);
-    s.programme[strcspn(s.programme, "\n")] = '\0';
-    if (!isValidProgramme(s.programme)) return; //have to match one of the allowed codes
+// =====================================================
+// CHANGE TRACKING
+// =====================================================
+// Helper: drop the changes every checkpoint has exported and every view that can still be repaired has seen
+// only done once at least half the log can go, so each entry is moved O(1) times on average
+static void trimChanges(Database *db) {
+    size_t now = db->changeBase + db->changeCount, keep = now;
+    for (size_t i = 0; i < db->checkpointCount; i++) //a partial checkpoint exports nothing before its full EXPORT
+        if (!db->checkpoints[i].partial && db->checkpoints[i].seq < keep) keep = db->checkpoints[i].seq;
+    for (int f = 0; f < SORT_FIELD_COUNT; f++) {
+        for (int d = 0; d < 2; d++) {
+            const SortView *v = &db->views[f][d];
+            if (v->built && v->version + VIEW_REPAIR_LIMIT >= now && v->version < keep)
+                keep = v->version; //a view further behind is sorted again anyway
+        }
+    }
+    size_t drop = keep - db->changeBase;
+    if (drop == 0 || drop * 2 < db->changeCount) return;
+    memmove(db->changeLog, db->changeLog + drop, (db->changeCount - drop) * sizeof *db->changeLog);
+    db->changeCount -= drop;
+    db->changeBase = keep;
+}
 
-    // MARK
-    printf("Enter mark (1-100): ");
-    fgets(buf, sizeof(buf), stdin);
-    buf[strcspn(buf, "\n")] = '\0';
+// Helper: make room for n more changes, returns 0 on success
+static int reserveChanges(Database *db, size_t n) {
+    if (db->changeCount + n <= db->changeCap) return 0;
+    trimChanges(db); //reuse the room of changes nobody needs before growing
+    if (db->changeCount + n <= db->changeCap) return 0;
+    size_t cap = db->changeCap ? db->changeCap * 2 : 64; //grow the log geometrically
+    while (cap < db->changeCount + n) cap *= 2;
+    ChangeEntry *grown = dbResize(db, db->changeLog, cap * sizeof *grown);
+    if (!grown) return -1;
+    db->changeLog = grown;
+    db->changeCap = cap;
+    return 0;
+}
 
-    if (buf[0] == '\0') { printf("Mark cannot be empty.\n"); return; } //empty check 
-    if (!isNumericString(buf)) { printf("Invalid mark. Must be numeric.\n"); return; } //reject letters/symbols
+// Helper: record that a row was inserted, updated or deleted
+static void logChange(Database *db, ChangeOp op, int id, size_t shard, size_t row) {
+    db->unsaved++;
+    if (db->autosave.stats.enabled && db->autosave.stats.mutations && db->unsaved >= db->autosave.stats.mutations)
+        pthread_cond_signal(&db->autosave.wake); //wake the writer, it takes the snapshot once this mutation releases the lock
+    if (reserveChanges(db, 1) != 0) { //without memory the next EXPORT CHANGES would miss rows
+        db->changeLogFailed = 1;
+        return;
+    }
+    db->changeLog[db->changeCount].id = id;
+    db->changeLog[db->changeCount].op = op;
+    db->changeLog[db->changeCount].shard = (unsigned)shard;
+    db->changeLog[db->changeCount].row = (unsigned)row;
+    db->changeCount++;
+}
 
-    float mark = atof(buf); //convert string to float 
-    if (!isValidMark(mark)) return; //ensure mark is within allowed range which is 1-100
-    //calls fullProgramme to convert short code to full name
-    strcpy(s.programme, fullProgramme(s.programme));
+// Helper: forget every change and checkpoint, used when a new database is opened
+static void clearChanges(Database *db) {
+    dbFree(db, db->changeLog);
+    db->changeLog = NULL;
+    db->changeCount = db->changeCap = db->changeBase = 0;
+    db->checkpointCount = 0;
+    db->changeLogFailed = 0;
+}
 
-    s.mark = mark;
-    s.grade = getGrade(mark); //calculation of grade
+// Helper: find a checkpoint by name, NULL if the table is full
+// a new one is partial, the files may hold changes of earlier sessions its reader never got, and the log starts at the open
+static Checkpoint *findCheckpoint(Database *db, const char *name) {
+    for (size_t i = 0; i < db->checkpointCount; i++)
+        if (strcmp(db->checkpoints[i].name, name) == 0) return &db->checkpoints[i];
+    if (db->checkpointCount == MAX_CHECKPOINTS) return NULL;
+    Checkpoint *cp = &db->checkpoints[db->checkpointCount++];
+    snprintf(cp->name, sizeof cp->name, "%s", name);
+    cp->seq = db_version(db);
+    cp->partial = 1;
+    return cp;
+}
 
-    records[recordCount++] = s; //add to database 
-    printf("\nRecord inserted successfully!\n");
+size_t db_version(const Database *db) {
+    return db->changeBase + db->changeCount;
 }
 
 // =====================================================
-// DELETE
+// NAME INDEX
 // =====================================================
-int deleteRecord(int id) {
-    int i = 0;
-    while (i < recordCount && records[i].id != id) i++; //search for the record with the matching ID 
+// Helper: lower case copy of a name, so matching ignores case, returns its length
+static size_t foldName(const char *name, char *out, size_t n) {
+    size_t len = 0;
+    for (; name[len] && len + 1 < n; len++) out[len] = (char)tolower((unsigned char)name[len]);
+    out[len] = '\0';
+    return len;
+}
 
-    if (i == recordCount) { //if the end is reached, ID does not exist 
-        printf("No record found with ID %d.\n", id);
-        return -1;
+// Helper: code of the three characters at p
+static size_t gramCode(const char *p) {
+    size_t code = 0;
+    for (int i = 0; i < 3; i++) {
+        int c = (unsigned char)p[i];
+        code = code * 28 + ((c == ' ') ? 0 : (c >= 'a' && c <= 'z') ? (size_t)(c - 'a' + 1) : 27);
     }
+    return code;
+}
 
-    printf("Found: ID=%d, Name=%s, Programme=%s, Mark=%.2f\n", //display record before deleting it 
-           records[i].id, records[i].name, records[i].programme, records[i].mark);
+static void freeNameIndex(Database *db) {
+    NameIndex *ni = db->names;
+    if (!ni) return;
+    for (size_t g = 0; g < NAME_GRAMS; g++) dbFree(db, ni->grams[g].entries);
+    dbFree(db, ni->firstWords.refs);
+    dbFree(db, ni->laterWords.refs);
+    dbFree(db, ni->entries);
+    dbFree(db, ni->keys);
+    dbFree(db, ni);
+    db->names = NULL;
+}
 
-    char conf[8];
-    printf("Confirm delete? (Y/N): ");
-    fgets(conf, sizeof(conf), stdin);
-    if (conf[0] != 'Y' && conf[0] != 'y') { //if the user does not type either Y or y, cancel the deletion 
-        printf("Deletion cancelled.\n");
-        return 1;
+// Helper: append a word to a list, returns 0 on success
+static int addWord(Database *db, WordList *wl, unsigned entry, unsigned key) {
+    if (wl->count == wl->cap) {
+        size_t cap = wl->cap ? wl->cap * 2 : 256;
+        WordRef *grown = dbResize(db, wl->refs, cap * sizeof *grown);
+        if (!grown) return -1;
+        wl->refs = grown;
+        wl->cap = cap;
+    }
+    wl->refs[wl->count].entry = entry;
+    wl->refs[wl->count].key = key;
+    wl->count++;
+    return 0;
+}
+
+// Helper: add an entry to the postings of a trigram, returns 0 on success
+static int addPosting(Database *db, Postings *pl, unsigned entry) {
+    if (pl->count && pl->entries[pl->count - 1] == entry) return 0; //trigram seen earlier in the same name
+    if (pl->count == pl->cap) {
+        size_t cap = pl->cap ? pl->cap * 2 : 8;
+        unsigned *grown = dbResize(db, pl->entries, cap * sizeof *grown);
+        if (!grown) return -1;
+        pl->entries = grown;
+        pl->cap = cap;
     }
+    pl->entries[pl->count++] = entry;
+    return 0;
+}
 
-    for (int j = i + 1; j < recordCount; j++) //shift all records after this index one step left to close the gap
-        records[j - 1] = records[j];
+// Helper: add the current name of an ID, its previous entry goes stale; returns 0 on success
+// slot is the ID's index entry, NULL for a lazy database whose names never change
+static int indexName(Database *db, int id, IdSlot *slot, const char *name) {
+    NameIndex *ni = db->names;
+    char key[MAX_STR_LEN];
+    size_t len = foldName(name, key, sizeof key);
+
+    if (ni->keyBytes + len + 1 > ni->keyCap) { //grow the arena geometrically
+        size_t cap = ni->keyCap ? ni->keyCap * 2 : 4096;
+        char *grown = dbResize(db, ni->keys, cap);
+        if (!grown) return -1;
+        ni->keys = grown;
+        ni->keyCap = cap;
+    }
+    if (ni->count == ni->cap) {
+        size_t cap = ni->cap ? ni->cap * 2 : 256;
+        NameEntry *grown = dbResize(db, ni->entries, cap * sizeof *grown);
+        if (!grown) return -1;
+        ni->entries = grown;
+        ni->cap = cap;
+    }
+    unsigned entry = (unsigned)ni->count, at = (unsigned)ni->keyBytes;
+    memcpy(ni->keys + at, key, len + 1);
+    ni->keyBytes += len + 1;
+    ni->entries[entry].id = id;
+    ni->entries[entry].key = at;
+    ni->count++;
+
+    int first = 1;
+    for (size_t p = 0; p < len; p++) { //every word, the first one separately so whole names rank first
+        if (key[p] == ' ' || (p > 0 && key[p - 1] != ' ')) continue;
+        if (addWord(db, first ? &ni->firstWords : &ni->laterWords, entry, at + (unsigned)p) != 0) return -1;
+        first = 0;
+    }
+    for (size_t p = 0; p + 3 <= len; p++)
+        if (addPosting(db, &ni->grams[gramCode(key + p)], entry) != 0) return -1;
 
-    recordCount--; //reduce count since one record got removed
-    printf("Record deleted.\n");
+    if (!slot || slot->nameEntry == NO_NAME_ENTRY) ni->live++; //otherwise the old entry is replaced
+    if (slot) slot->nameEntry = entry;
     return 0;
 }
 
-// =====================================================
-// SAVE DATABASE (.txt)
-// =====================================================
-    int saveDatabase(const char *path) {
-        char clean[512];  //variable to hold cleaned path
+// Helper: stable merge sort of words by their key, tmp must hold n entries
+static void mergeSortWords(const char *keys, WordRef *refs, WordRef *tmp, size_t n) {
+    if (n < 2) return;
+    size_t mid = n / 2;
+    mergeSortWords(keys, refs, tmp, mid);
+    mergeSortWords(keys, refs + mid, tmp, n - mid);
+
+    size_t i = 0, j = mid, k = 0;
+    while (i < mid && j < n)
+        tmp[k++] = (strcmp(keys + refs[j].key, keys + refs[i].key) < 0) ? refs[j++] : refs[i++];
+    while (i < mid) tmp[k++] = refs[i++];
+    while (j < n) tmp[k++] = refs[j++];
+    memcpy(refs, tmp, n * sizeof *refs);
+}
 
-        // if path is NULL or empty, return error and exit function
-        if (!path || path[0] == '\0') {
-            fprintf(stderr, "SAVE: no file path specified\n");
-            return -1;
-        }
+// Helper: sort the words added since the last merge into the recent run, and the recent run into the large one when it has grown
+// merging into the short recent run keeps the cost of a change low on a large index, returns 0 on success
+static int mergeWords(Database *db, WordList *wl, const char *keys) {
+    if (wl->recent == wl->count) return 0;
+    WordRef *tmp = dbAlloc(db, wl->count * sizeof *tmp);
+    if (!tmp) return -1;
+    mergeSortWords(keys, wl->refs + wl->recent, tmp, wl->count - wl->recent);
+
+    size_t from = wl->sorted;
+    for (int pass = 0; pass < 2; pass++) { //tail into the recent run, then maybe the recent run into the large one
+        size_t i = from, j = wl->recent, k = 0;
+        while (i < wl->recent && j < wl->count)
+            tmp[k++] = (strcmp(keys + wl->refs[j].key, keys + wl->refs[i].key) < 0) ? wl->refs[j++] : wl->refs[i++];
+        while (i < wl->recent) tmp[k++] = wl->refs[i++];
+        while (j < wl->count) tmp[k++] = wl->refs[j++];
+        memcpy(wl->refs + from, tmp, k * sizeof *tmp);
+        wl->recent = wl->count;
+        if (from == 0 || (wl->count - wl->sorted) * NAME_RECENT_SHARE <= wl->sorted) break;
+        wl->recent = wl->sorted; //merge the whole recent run as the new words
+        from = 0;
+    }
+    if (from == 0) wl->sorted = wl->count;
+    dbFree(db, tmp);
+    return 0;
+}
 
-        //calling clean_path function to sanitize the input path
-        clean_path(path, clean, sizeof clean);
-        FILE *fp = fopen(clean, "w");
-        if (!fp) {
-            perror("SAVE");
+typedef struct {
+    Database *db;
+    WordList *wl;
+    int err;
+} MergeArgs;
+
+static void *mergeWordsJob(void *arg) {
+    MergeArgs *a = arg;
+    a->err = mergeWords(a->db, a->wl, a->db->names->keys);
+    return NULL;
+}
+
+// Helper: index the name of every record, returns 0 on success
+static int buildNameIndex(Database *db) {
+    db->names = dbZalloc(db, sizeof *db->names);
+    if (!db->names) return -1;
+    for (size_t i = 0; i < db->idCap; i++) { //duplicate rows QUERY cannot reach are left out as well
+        IdSlot *slot = &db->idIndex[i];
+        if (!slot->used) continue;
+        slot->nameEntry = NO_NAME_ENTRY;
+        const Student *s = shardRow(&db->shards[slot->shard], slot->row);
+        if (s && indexName(db, s->id, slot, s->name) != 0) {
+            freeNameIndex(db);
             return -1;
         }
-
-        //saves the header as well as the student records in tab-separated format into the file
-        fprintf(fp, "ID\tName\tProgramme\tMark\n");
-        for (int i = 0; i < recordCount; i++) {
-            fprintf(fp, "%d\t%s\t%s\t%.1f\n",
-                    records[i].id,
-                    records[i].name,
-                    records[i].programme,
-                    records[i].mark);
+    }
+    for (size_t sh = 0; db->lazyMode && sh < db->shardCount; sh++) { //a lazy database has no ID index to walk
+        for (size_t r = 0; r < db->shards[sh].count; r++) {
+            size_t first, row;
+            if (!locateId(db, shardRowId(&db->shards[sh], r), &first, &row) || first != sh || row != r) continue; //duplicate
+            const Student *s = shardRow(&db->shards[sh], r);
+            if (!s) continue; //a mapped line that no longer parses cannot be found
+            if (indexName(db, s->id, NULL, s->name) != 0) {
+                freeNameIndex(db);
+                return -1;
+            }
         }
-
-        fclose(fp);
-        return 0;
     }
+    MergeArgs first = {db, &db->names->firstWords, 0}, later = {db, &db->names->laterWords, 0};
+    pthread_t thread;
+    int started = (pthread_create(&thread, NULL, mergeWordsJob, &later) == 0); //the two lists sort at the same time
+    if (!started) mergeWordsJob(&later);
+    mergeWordsJob(&first);
+    if (started) pthread_join(thread, NULL);
+    if (first.err || later.err) {
+        freeNameIndex(db);
+        return -1;
+    }
+    return 0;
+}
 
-// =====================================================
-// EXPORT TO CSV
-// =====================================================
-int exportToCSV(const char *csvPath) {
-    FILE *csv = fopen(csvPath, "w"); //open the csv file for writing. "w" creates/overwrites the file 
-    if (!csv) { perror("CSV"); return -1; } //prints error message if file cannot be opened/created, return -1 to signal failure
-
-    fprintf(csv, "ID,Name,Programme,Mark,Grade\n"); //write the csv header row 
-    for (int i = 0; i < recordCount; i++) { //loop through existing records and write each one to the csv file
-        fprintf(csv, "%d,\"%s\",\"%s\",%.1f,%c\n",
-                records[i].id, records[i].name,
-                records[i].programme, records[i].mark,
-                records[i].grade);
-    } //quotation marks are added around strings to avoid issues if the name contains spaces
+// Helper: keep the index in step with an inserted or renamed record
+// without memory the index is dropped, and the next FIND NAME builds it again
+static void nameChanged(Database *db, IdSlot *slot, const char *name) {
+    NameIndex *ni = db->names;
+    if (!ni) return;
+    if (indexName(db, slot->id, slot, name) != 0) {
+        freeNameIndex(db);
+        return;
+    }
+    if (ni->firstWords.count - ni->firstWords.recent > NAME_MERGE_LIMIT && mergeWords(db, &ni->firstWords, ni->keys) != 0) {
+        freeNameIndex(db);
+        return;
+    }
+    if (ni->laterWords.count - ni->laterWords.recent > NAME_MERGE_LIMIT && mergeWords(db, &ni->laterWords, ni->keys) != 0)
+        freeNameIndex(db); //checked on its own, one name can add words to both lists
+}
 
-    fclose(csv); //close csv file to save changes 
-    return 0; //indicate success
+// Helper: a record was deleted, its entry is stale now
+static void nameRemoved(Database *db) {
+    if (db->names) db->names->live--;
 }
 
-// =====================================================
-// ACCESSORS
-// =====================================================
-size_t db_count(void) {
-     return recordCount; 
+// Helper: once the row an ID leads to is deleted, point the ID at the next row holding it, so that copy stays reachable
+// rows are searched in shard order, the order the ID index took the first copy in; only needed while duplicates remain
+static void idRestore(Database *db, int id) {
+    if (db->duplicates == 0 || db->lazyMode) return;
+    for (size_t s = 0; s < db->shardCount; s++) {
+        for (size_t r = 0; r < db->shards[s].count; r++) {
+            const Student *st = rowAt(&db->shards[s], r);
+            if (st->id != id) continue;
+            if (idPut(db, id, s, r) <= 0) return; //without memory the copy stays unreachable, as before
+            nameChanged(db, idFind(db, id), st->name);
+            db->duplicates--;
+            return;
+        }
     }
+}
 
-Student* db_get(size_t idx) {
-    return (idx < recordCount) ? &records[idx] : NULL;
+// Helper: 1 if a name entry is still the current name of its student
+static int entryLive(const Database *db, unsigned entry) {
+    if (db->lazyMode) return 1; //names of a lazy database never change
+    IdSlot *slot = idFind(db, db->names->entries[entry].id);
+    return slot && slot->nameEntry == entry;
 }
 
-// =====================================================
-// SHOW ALL (UPDATED ALIGNMENT!)
-// =====================================================
-void showAll() {
-    printf("-----------------------------------------------------------------------------\n");
-    printf("%-8s %-20s %-25s %6s %5s\n", "ID", "Name", "Programme", "Mark", "Grade");
-    printf("-----------------------------------------------------------------------------\n");
-    for (int i = 0; i < recordCount; i++) {
-        printf("%-8d %-20s %-25s %6.1f %5c\n",
-               records[i].id,
-               records[i].name,
-               records[i].programme,
-               records[i].mark,
-               records[i].grade);
+typedef struct {
+    int *ids;  //matching IDs, best first
+    size_t count, limit;
+} FindResults;
+
+static void addMatch(FindResults *r, int id) {
+    for (size_t i = 0; i < r->count; i++)
+        if (r->ids[i] == id) return; //already found by an earlier pass
+    r->ids[r->count++] = id;
+}
+
+// Helper: first of n sorted words not below q
+static size_t firstWordFrom(const char *keys, const WordRef *refs, size_t n, const char *q) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(keys + refs[mid].key, q) < 0) lo = mid + 1;
+        else hi = mid;
     }
-    printf("-----------------------------------------------------------------------------\n");
+    return lo;
 }
 
-// =====================================================
-// GRADE DISTRIBUTION
-// =====================================================
-void showGradeDistribution() {
-    size_t n = db_count();
-    if (n == 0) {
-        return;
+// Helper: add the current names with a word in the list starting with q, in key order, until the results are full
+static void findPrefix(const Database *db, const WordList *wl, const char *q, size_t qlen, FindResults *r) {
+    const char *keys = db->names->keys;
+    WordRef tail[NAME_MERGE_LIMIT + 1]; //the unsorted words that match, sorted here so every part merges in key order
+    size_t nTail = 0;
+    for (size_t k = wl->recent; k < wl->count && nTail < NAME_MERGE_LIMIT + 1; k++) {
+        if (strncmp(keys + wl->refs[k].key, q, qlen) != 0) continue;
+        size_t at = nTail++;
+        while (at > 0 && strcmp(keys + tail[at - 1].key, keys + wl->refs[k].key) > 0) { //insertion sort, the tail is short
+            tail[at] = tail[at - 1];
+            at--;
+        }
+        tail[at] = wl->refs[k];
     }
 
-    const char *gradeLabels[] = {"A", "B", "C", "D", "F"};
-    const char *gradeRanges[] = {"(80-100)", "(70-79) ", "(60-69) ", "(50-59) ", "(0-49)  "};
+    const WordRef *runs[3] = {wl->refs, wl->refs + wl->sorted, tail}; //large run, recent run, tail
+    size_t ends[3] = {wl->sorted, wl->recent - wl->sorted, nTail}, next[3];
+    next[0] = firstWordFrom(keys, runs[0], ends[0], q);
+    next[1] = firstWordFrom(keys, runs[1], ends[1], q);
+    next[2] = 0;
+
+    while (r->count < r->limit) {
+        const WordRef *best = NULL;
+        size_t from = 0;
+        for (size_t k = 0; k < 3; k++) { //smallest next word that still has the prefix
+            if (next[k] == ends[k]) continue;
+            const WordRef *w = &runs[k][next[k]];
+            if (strncmp(keys + w->key, q, qlen) != 0) continue;
+            if (!best || strcmp(keys + w->key, keys + best->key) < 0) {
+                best = w;
+                from = k;
+            }
+        }
+        if (!best) break; //past every word with this prefix
+        next[from]++;
+        if (entryLive(db, best->entry)) addMatch(r, db->names->entries[best->entry].id);
+    }
+}
 
-    // Initialize counters
-    int gradeCounts[5] = {0};
-    
-    // Count grades
-    for (size_t i = 0; i < n; i++) {
-        const Student *s = db_get(i);
+// Helper: add the current names containing q anywhere, candidates come from the rarest trigram of q
+static void findSubstring(const Database *db, const char *q, size_t qlen, FindResults *r) {
+    const NameIndex *ni = db->names;
+    const Postings *rarest = &ni->grams[gramCode(q)];
+    for (size_t p = 1; p + 3 <= qlen; p++)
+        if (ni->grams[gramCode(q + p)].count < rarest->count) rarest = &ni->grams[gramCode(q + p)];
 
-        switch (s->grade) {
-            case 'A': gradeCounts[0]++; break;
-            case 'B': gradeCounts[1]++; break;
-            case 'C': gradeCounts[2]++; break;
-            case 'D': gradeCounts[3]++; break;
-            case 'F': gradeCounts[4]++; break;
-        }
+    for (size_t k = 0; k < rarest->count && r->count < r->limit; k++) {
+        unsigned entry = rarest->entries[k];
+        if (strstr(ni->keys + ni->entries[entry].key, q) && entryLive(db, entry)) addMatch(r, ni->entries[entry].id);
     }
+}
 
-    printf("\n------------------------------------------------------");
-    printf("\n|                 Grade Distribution                 |");
-    printf("\n------------------------------------------------------\n");
-    for (int i = 0; i < 5; i++) {
-        float percentage = (gradeCounts[i] * 100.0) / n;
-        printf("Grade %s %s: %2d students (%.1f%%)\t", 
-               gradeLabels[i], gradeRanges[i], gradeCounts[i], percentage);
-        
-        // Simple bar chart
-        int bars = (int)(percentage / 5);  // Each bar = 5%
-        for (int j = 0; j < bars; j++) {
-            printf("\xDB");
-        }
-        printf("\n\n");
+// matches are ranked: whole name or name prefix, then a later word starting with the text, then the text anywhere
+// names within the first two ranks come in alphabetical order, so an exact match is always first
+long db_find_name(Database *db, const char *text, size_t limit, DbVisitor visit, void *ctx) {
+    char q[MAX_STR_LEN];
+    if (!text || limit == 0) return DB_ERR_INVALID_ARGUMENT;
+    while (*text == ' ') text++;
+    size_t qlen = foldName(text, q, sizeof q);
+    while (qlen && q[qlen - 1] == ' ') q[--qlen] = '\0';
+    if (qlen == 0) return DB_ERR_INVALID_ARGUMENT;
+
+    if (db->names && db->names->count > 2 * db->names->live + NAME_MERGE_LIMIT)
+        freeNameIndex(db); //mostly stale entries of renamed and deleted students, start over
+    if (!db->names && buildNameIndex(db) != 0) return DB_ERR_NO_MEMORY;
+
+    FindResults r = {dbAlloc(db, limit * sizeof *r.ids), 0, limit};
+    if (!r.ids) return DB_ERR_NO_MEMORY;
+    findPrefix(db, &db->names->firstWords, q, qlen, &r);
+    findPrefix(db, &db->names->laterWords, q, qlen, &r);
+    if (qlen >= 3) findSubstring(db, q, qlen, &r); //shorter text has no trigram, and prefixes cover it well
+
+    for (size_t i = 0; i < r.count; i++) {
+        size_t shard, row;
+        const Student *s = locateId(db, r.ids[i], &shard, &row) ? shardRow(&db->shards[shard], row) : NULL;
+        if (s && visit(s, ctx)) break; //visitor asked to stop
     }
+    dbFree(db, r.ids);
+    return (long)r.count;
 }
 
 // =====================================================
-// SUMMARY
+// SORTING
 // =====================================================
-void showSummary() {
-    if (recordCount == 0) { //if no records, nothing to summarize
-        printf("No records available.\n");
-        return;
+// returns > 0 if a belongs after b, < 0 if before and 0 if they are equal for this field
+int compareStudents(const Student *a, const Student *b, SortField field, int ascending) {
+    int c = 0;
+    switch (field) { //decide which field to sort by
+        case SORT_ID:
+            c = (a->id > b->id) - (a->id < b->id);
+            break;
+
+        case SORT_MARK:
+            c = (a->mark > b->mark) - (a->mark < b->mark);
+            break;
+
+        case SORT_GRADE:
+            if (a->grade == b->grade) //if grades are equal, sort by mark as a secondary rule
+                c = (a->mark > b->mark) - (a->mark < b->mark);
+            else
+                c = (a->grade > b->grade) - (a->grade < b->grade);
+            break;
+
+        case SORT_NAME:
+            c = strcmp(a->name, b->name); //string comparison for alphabetical ordering
+            break;
+
+        case SORT_PROGRAMME:
+            c = strcmp(a->programme, b->programme); //sort alphabetically by programme name
+            break;
+
+        default:
+            break;
+    }
+    return ascending ? c : -c;
+}
+
+// Helper: stable merge sort of row numbers, tmp must hold n entries
+static void mergeSortOrder(const Shard *sh, size_t *order, size_t *tmp, size_t n, SortField field, int ascending) {
+    if (n < 2) return;
+    size_t mid = n / 2;
+    mergeSortOrder(sh, order, tmp, mid, field, ascending);
+    mergeSortOrder(sh, order + mid, tmp, n - mid, field, ascending);
+
+    size_t i = 0, j = mid, k = 0;
+    while (i < mid && j < n) //take from the left half on ties so equal rows keep their order
+        tmp[k++] = (compareStudents(rowAt(sh, order[j]), rowAt(sh, order[i]), field, ascending) < 0) ? order[j++] : order[i++];
+    while (i < mid) tmp[k++] = order[i++];
+    while (j < n) tmp[k++] = order[j++];
+    memcpy(order, tmp, n * sizeof *order);
+}
+
+typedef struct {
+    SortField field;
+    int ascending;
+    size_t *order;  //the shard's row numbers in sorted order
+} SortArgs;
+
+static void sortShardJob(Shard *sh, void *arg) {
+    SortArgs *a = arg;
+    size_t n = sh->count ? sh->count : 1;
+    size_t *tmp = dbAlloc(sh->db, n * sizeof *tmp);
+    a->order = dbAlloc(sh->db, n * sizeof *a->order);
+    if (tmp && a->order) {
+        for (size_t i = 0; i < sh->count; i++) a->order[i] = i;
+        mergeSortOrder(sh, a->order, tmp, sh->count, a->field, a->ascending);
+    } else {
+        dbFree(sh->db, a->order);
+        a->order = NULL;
     }
+    dbFree(sh->db, tmp);
+}
 
-    float total = 0; //total will accumulate all the marks so we can calculate the average 
-    float high = records[0].mark;
-    float low = records[0].mark; //initialise highest and lowest mark to the first student's mark 
-    int idxH = 0, idxL = 0; //idxH stores the index of the student with the highest mark, idxL is for the lowest
+// Helper: make room for n rows in a view, returns 0 on success
+static int reserveView(Database *db, SortView *v, size_t n) {
+    if (n <= v->cap) return 0;
+    size_t cap = v->cap ? v->cap : 64;
+    while (cap < n) cap *= 2;
+    RowRef *grown = dbResize(db, v->refs, cap * sizeof *grown);
+    if (!grown) return -1;
+    v->refs = grown;
+    v->cap = cap;
+    return 0;
+}
 
-    // Calculate total, highest, and lowest marks
-    for (int i = 0; i < recordCount; i++) {
-        total += records[i].mark;
-        if (records[i].mark > high) {
-            high = records[i].mark;
-            idxH = i;
-        }
-        if (records[i].mark < low) {
-            low = records[i].mark;
-            idxL = i;
+// Helper: sort every shard on its own thread and k-way merge them into the view, returns 0 on success
+static int buildView(Database *db, SortView *v, SortField field, int ascending) {
+    SortArgs args[MAX_SHARDS];
+    size_t pos[MAX_SHARDS] = {0};
+    Shard *shards = db->shards;
+    int rc = reserveView(db, v, db_count(db));
+
+    for (size_t i = 0; i < db->shardCount; i++) {
+        args[i].field = field;
+        args[i].ascending = ascending;
+        args[i].order = NULL;
+    }
+    if (rc == 0 && db->shardCount > 0) runParallel(shards, db->shardCount, sortShardJob, args, sizeof args[0]);
+    for (size_t i = 0; i < db->shardCount; i++) if (!args[i].order) rc = -1;
+
+    v->count = 0;
+    while (rc == 0) { //take the smallest head of all shards, ties stay with the earlier shard so the merge is stable
+        long best = -1;
+        for (size_t i = 0; i < db->shardCount; i++) {
+            if (pos[i] >= shards[i].count) continue;
+            if (best < 0 || compareStudents(rowAt(&shards[i], args[i].order[pos[i]]),
+                                            rowAt(&shards[best], args[best].order[pos[best]]), field, ascending) < 0)
+                best = (long)i;
         }
+        if (best < 0) break;
+        v->refs[v->count].shard = (unsigned)best;
+        v->refs[v->count++].row = (unsigned)args[best].order[pos[best]++];
     }
 
-    printf("\n---------------------------------------\n");
-    printf("Summary Statistics\n");
-    printf("---------------------------------------\n");
-    printf("Total students: %d\n", recordCount);
-    printf("Average mark : %.2f\n", total / recordCount);
-    printf("Highest mark : %.2f (%s)\n", high, records[idxH].name);
-    printf("Lowest mark  : %.2f (%s)\n", low, records[idxL].name);
-    printf("---------------------------------------\n");
+    for (size_t i = 0; i < db->shardCount; i++) dbFree(db, args[i].order);
+    v->built = (rc == 0);
+    return rc;
+}
 
-    showGradeDistribution();
+// Helper: move a row reference through changes n of the log, returns 0 if the row was deleted or updated on the way
+static int followChanges(const ChangeEntry *log, size_t n, RowRef *ref) {
+    for (size_t i = 0; i < n; i++) {
+        if (log[i].shard != ref->shard || log[i].op == CHANGE_INSERT) continue; //appends never move a row
+        if (log[i].row == ref->row) return 0; //its sort key changed or it is gone
+        if (log[i].op == CHANGE_DELETE && log[i].row < ref->row) ref->row--; //the gap before it was closed
+    }
+    return 1;
 }
 
-// =====================================================
-// SORTING
-// =====================================================
-void sortStudents(SortField field, int ascending) { //repeatedly compare and swap neighbouring elements 
-    for (int i = 0; i < recordCount - 1; i++) {
-        for (int j = 0; j < recordCount - i - 1; j++) {
-            Student *s1 = &records[j]; //pointers to the two student records being compared 
-            Student *s2 = &records[j + 1];
-            int swap = 0; //flag to determine if a swap should happen
-            switch (field) { //decide which field to sort by 
-                case SORT_ID:
-                    swap = ascending ? (s1->id > s2->id) : (s1->id < s2->id); //compare IDs, if sorting from low to high, check if first ID is bigger than the second. vice versa
-                    break;
-
-                case SORT_MARK:
-                    swap = ascending ? (s1->mark > s2->mark) : (s1->mark < s2->mark); //compare marks
-                    break;
-
-                case SORT_GRADE: 
-                    if (s1->grade == s2->grade) //if grades are equal, sort by mark as a secondary rule
-                        swap = ascending ? (s1->mark > s2->mark) : (s1->mark < s2->mark);
-                    else
-                        swap = ascending ? (s1->grade > s2->grade) : (s1->grade < s2->grade);
-                    break;
-
-                case SORT_NAME:
-                    swap = ascending ? (strcmp(s1->name, s2->name) > 0) //string comparison for alphabetical ordering 
-                                     : (strcmp(s1->name, s2->name) < 0);
-                    break;
-
-                case SORT_PROGRAMME:
-                    swap = ascending ? (strcmp(s1->programme, s2->programme) > 0) //sort alphabetically by programme name
-                                     : (strcmp(s1->programme, s2->programme) < 0);
-                    break;
-            }
+// Helper: replay the changes since the view was built, moving only the changed rows, returns 0 on success
+static int repairView(Database *db, SortView *v, SortField field, int ascending) {
+    const ChangeEntry *log = db->changeLog + (v->version - db->changeBase);
+    size_t n = db->changeCount - (v->version - db->changeBase);
 
-            if (swap) { //if swap flag is set, exchange the two records
-                Student temp = *s1;
-                *s1 = *s2;
-                *s2 = temp;
-            }
+    size_t kept = 0;
+    for (size_t k = 0; k < v->count; k++) { //take out the changed rows and renumber the rest in one pass
+        RowRef ref = v->refs[k];
+        if (followChanges(log, n, &ref)) v->refs[kept++] = ref;
+    }
+    v->count = kept;
+
+    for (size_t i = 0; i < n; i++) { //binary insert the inserted and updated rows that are still there at the end
+        RowRef ref = {log[i].shard, log[i].row};
+        if (log[i].op == CHANGE_DELETE || !followChanges(log + i + 1, n - i - 1, &ref)) continue;
+        const Student *s = rowAt(&db->shards[ref.shard], ref.row);
+        size_t lo = 0, hi = v->count;
+        while (lo < hi) { //position after every equal row
+            size_t mid = lo + (hi - lo) / 2;
+            if (compareStudents(rowAt(&db->shards[v->refs[mid].shard], v->refs[mid].row), s, field, ascending) <= 0) lo = mid + 1;
+            else hi = mid;
         }
+        if (reserveView(db, v, v->count + 1) != 0) return -1;
+        memmove(&v->refs[lo + 1], &v->refs[lo], (v->count - lo) * sizeof *v->refs);
+        v->refs[lo] = ref;
+        v->count++;
+    }
+    return 0;
+}
+
+// Helper: view for a field and direction, reused if nothing changed, repaired after a few changes, rebuilt otherwise
+// only db_sort() requests are counted, not the later reads of the active view
+static const SortView *ensureView(Database *db, SortField field, int ascending, int counted) {
+    SortView *v = &db->views[field][ascending ? 1 : 0];
+    size_t pending = db_version(db) - v->version;
+
+    if (v->built && !db->changeLogFailed && pending == 0) {
+        if (counted) db->viewStats.hits++;
+        return v;
+    }
+    if (v->built && !db->changeLogFailed && pending <= VIEW_REPAIR_LIMIT && v->version >= db->changeBase &&
+        repairView(db, v, field, ascending) == 0) {
+        if (counted) db->viewStats.repairs++;
+        v->version = db_version(db);
+        return v;
+    }
+    if (counted) db->viewStats.misses++;
+    if (buildView(db, v, field, ascending) != 0) return NULL;
+    v->version = db_version(db);
+    return v;
+}
+
+// Helper: view of the last db_sort(), NULL for file order
+static const SortView *currentView(Database *db) {
+    return (db->activeField >= 0) ? ensureView(db, (SortField)db->activeField, db->activeAscending, 0) : NULL;
+}
+
+// Helper: drop every cached view, used when a new database is opened
+static void clearViews(Database *db) {
+    for (int f = 0; f < SORT_FIELD_COUNT; f++) {
+        for (int d = 0; d < 2; d++) {
+            dbFree(db, db->views[f][d].refs);
+            memset(&db->views[f][d], 0, sizeof db->views[f][d]);
+        }
+    }
+    db->activeField = -1;
+}
+
+int db_sort(Database *db, SortField field, int ascending) { //iteration, EXPORT and SAVE follow this order until the next sort
+    if ((int)field < 0 || field >= SORT_FIELD_COUNT) return DB_ERR_INVALID_ARGUMENT;
+    //a lazy database keeps only the ID index, sorting would decode every row O(n log n) times through the small row
+    //cache or hold every sort key in memory, which is what OPEN LAZY avoids; SHOW ALL keeps file order there
+    if (db->lazyMode) return DB_ERR_READ_ONLY;
+    if (!ensureView(db, field, ascending, 1)) return DB_ERR_NO_MEMORY;
+    db->activeField = field;
+    db->activeAscending = ascending;
+    return DB_OK;
+}
+
+void db_view_stats(const Database *db, ViewStats *out) {
+    *out = db->viewStats;
+}
+
+// =====================================================
+// Helper: Walk the rows in output order
+// =====================================================
+typedef struct {
+    const SortView *view;  //sorted order to follow, NULL for file order
+    size_t pos;  //next position in the view
+    size_t shard, row;  //next row in file order
+} RowCursor;
+
+// returns the shard holding the next row and stores the row, -1 once every row was visited
+static long nextRow(const Database *db, RowCursor *c, size_t *row) {
+    if (c->view) {
+        if (c->pos >= c->view->count) return -1;
+        *row = c->view->refs[c->pos].row;
+        return (long)c->view->refs[c->pos++].shard;
+    }
+    while (c->shard < db->shardCount && c->row >= db->shards[c->shard].count) { //move on to the next non-empty shard
+        c->shard++;
+        c->row = 0;
+    }
+    if (c->shard >= db->shardCount) return -1;
+    *row = c->row++;
+    return (long)c->shard;
+}
+
+// =====================================================
+// Helper: Validate the fields of a record
+// =====================================================
+// Helper: 1 if text can be stored as it is, a tab, line break or quote would split a field of the file, journal or CSV
+static int isPlainText(const char *text) {
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++)
+        if (*p < 0x20 || *p == 0x7f || *p == '"') return 0;
+    return 1;
+}
+
+// name, programme and mark rules shared by INSERT and UPDATE, returns DB_OK or the first broken rule
+static int checkFields(const Student *s) {
+    if (!isValidName(s->name)) return DB_ERR_INVALID_NAME;
+    if (s->programme[0] == '\0' || !isPlainText(s->programme)) return DB_ERR_INVALID_PROGRAMME; //callers of the handle skip the CLI's checks
+    if (!isValidMark(s->mark)) return DB_ERR_INVALID_MARK;
+    return DB_OK;
+}
+
+// =====================================================
+// TRANSACTIONS
+// =====================================================
+static size_t txnHash(int id, size_t cap) {
+    return ((unsigned)id * 2654435761u) & (cap - 1);
+}
+
+// Helper: buffered change of an ID, NULL if the open transaction has not touched it
+static PendingChange *txnFind(const Database *db, int id) {
+    const Transaction *t = &db->txn;
+    if (t->slotCap == 0) return NULL;
+    for (size_t i = txnHash(id, t->slotCap); t->slots[i]; i = (i + 1) & (t->slotCap - 1))
+        if (t->changes[t->slots[i] - 1].id == id) return &t->changes[t->slots[i] - 1];
+    return NULL;
+}
+
+// Helper: buffered change of an ID, started from the table's copy of the record if it is new; NULL if out of memory
+static PendingChange *txnTouch(Database *db, int id) {
+    Transaction *t = &db->txn;
+    PendingChange *pc = txnFind(db, id);
+    if (pc) return pc;
+
+    if (t->count == t->cap) { //grow the change list geometrically
+        size_t cap = t->cap ? t->cap * 2 : 64;
+        PendingChange *grown = dbResize(db, t->changes, cap * sizeof *grown);
+        if (!grown) return NULL;
+        t->changes = grown;
+        t->cap = cap;
+    }
+    if ((t->count + 1) * 2 > t->slotCap) { //keep the table at most half full, rebuilt from the change list
+        size_t cap = t->slotCap ? t->slotCap * 2 : 128;
+        size_t *grown = dbZalloc(db, cap * sizeof *grown);
+        if (!grown) return NULL;
+        dbFree(db, t->slots);
+        t->slots = grown;
+        t->slotCap = cap;
+        for (size_t k = 0; k < t->count; k++) {
+            size_t i = txnHash(t->changes[k].id, cap);
+            while (t->slots[i]) i = (i + 1) & (cap - 1);
+            t->slots[i] = k + 1;
+        }
+    }
+
+    pc = &t->changes[t->count];
+    memset(pc, 0, sizeof *pc);
+    pc->id = id;
+    IdSlot *slot = idFind(db, id);
+    if (slot) {
+        pc->inTable = pc->present = 1;
+        pc->shard = slot->shard;
+        pc->rec = *rowAt(&db->shards[slot->shard], slot->row);
+    }
+    size_t i = txnHash(id, t->slotCap);
+    while (t->slots[i]) i = (i + 1) & (t->slotCap - 1);
+    t->slots[i] = ++t->count;
+    return pc;
+}
+
+// Helper: record of an ID as the open transaction sees it, NULL if it does not exist there
+static const Student *txnVisible(Database *db, int id) {
+    PendingChange *pc = txnFind(db, id);
+    if (pc) return pc->present ? &pc->rec : NULL;
+    IdSlot *slot = idFind(db, id);
+    return slot ? rowAt(&db->shards[slot->shard], slot->row) : NULL; //a transaction is never open on a lazy database
+}
+
+// Helper: forget every buffered change, the transaction is closed
+static void clearTransaction(Database *db) {
+    dbFree(db, db->txn.changes);
+    dbFree(db, db->txn.slots);
+    memset(&db->txn, 0, sizeof db->txn);
+}
+
+// Helper: buffer an INSERT, checked against the table with the earlier changes of the transaction applied
+static int stageInsert(Database *db, size_t shard, const Student *s) {
+    if (shard >= (db->shardCount ? db->shardCount : 1)) return DB_ERR_INVALID_ARGUMENT;
+    if (s->id < 1000000 || s->id > 9999999) return DB_ERR_INVALID_ID;
+    if (txnVisible(db, s->id)) return DB_ERR_DUPLICATE;
+    int rc = checkFields(s);
+    if (rc != DB_OK) return rc;
+
+    PendingChange *pc = txnTouch(db, s->id);
+    if (!pc) return DB_ERR_NO_MEMORY;
+    if (!pc->inTable) pc->shard = shard; //an ID deleted and inserted again in one transaction keeps its row
+    pc->present = 1;
+    pc->rec = *s;
+    pc->rec.grade = getGrade(s->mark);
+    return DB_OK;
+}
+
+// Helper: buffer an UPDATE
+static int stageUpdate(Database *db, const Student *s) {
+    const Student *cur = txnVisible(db, s->id);
+    if (!cur) return DB_ERR_NOT_FOUND;
+    int rc = checkFields(s);
+    if (rc != DB_OK) return rc;
+    if (strcmp(cur->name, s->name) == 0 && strcmp(cur->programme, s->programme) == 0 && cur->mark == s->mark)
+        return DB_OK; //nothing changed
+
+    PendingChange *pc = txnTouch(db, s->id);
+    if (!pc) return DB_ERR_NO_MEMORY;
+    snprintf(pc->rec.name, sizeof pc->rec.name, "%s", s->name);
+    snprintf(pc->rec.programme, sizeof pc->rec.programme, "%s", s->programme);
+    pc->rec.mark = s->mark;
+    pc->rec.grade = getGrade(s->mark);
+    return DB_OK;
+}
+
+// Helper: buffer a DELETE
+static int stageDelete(Database *db, int id) {
+    if (!txnVisible(db, id)) return DB_ERR_NOT_FOUND;
+    PendingChange *pc = txnTouch(db, id);
+    if (!pc) return DB_ERR_NO_MEMORY;
+    pc->present = 0;
+    return DB_OK;
+}
+
+// Helper: journal file of the database, 0 if no file is open to name it after
+static int journalPath(const Database *db, char *out, size_t n) {
+    if (db->shardCount == 0 || db->shards[0].path[0] == '\0') return 0;
+    return (size_t)snprintf(out, n, "%s.journal", db->shards[0].path) < n;
+}
+
+// Helper: empty the journal once the files hold every change in it, the database lock must be held
+static void resetJournal(Database *db) {
+    char path[528];
+    if (journalPath(db, path, sizeof path)) remove(path);
+    db->journalBytes = 0;
+    db->journalGen++;
+}
+
+// Helper: append the transaction as one block of whole records and sync it once, returns 0 or an errno value
+// a block that could not be written completely is cut off again, so the journal only ever ends in a complete block
+static int writeJournal(Database *db, const PendingChange *changes, size_t count, int sync) {
+    char path[528];
+    if (!journalPath(db, path, sizeof path)) return 0; //nothing was opened, so there is no file to recover either
+    FILE *fp = fopen(path, "a");
+    if (!fp) return errno ? errno : EIO;
+    fseek(fp, 0, SEEK_END);
+    long start = ftell(fp);
+
+    size_t records = 0;
+    int touched[MAX_SHARDS] = {0};
+    for (size_t k = 0; k < count; k++) {
+        if (changes[k].op < 0) continue;
+        records++;
+        touched[changes[k].shard] = 1;
+    }
+    fprintf(fp, "BEGIN %zu\n", records);
+    for (size_t s = 0; s < MAX_SHARDS; s++) //records name files by shard, so the block says which file each shard was
+        if (touched[s]) fprintf(fp, "FILE\t%zu\t%s\n", s, db->shards[s].path);
+    for (size_t k = 0; k < count; k++) {
+        const PendingChange *pc = &changes[k];
+        if (pc->op == CHANGE_DELETE)
+            fprintf(fp, "D\t%zu\t%d\n", pc->shard, pc->id);
+        else if (pc->op >= 0)
+            fprintf(fp, "%c\t%zu\t%d\t%s\t%s\t%.2f\n", pc->op == CHANGE_INSERT ? 'I' : 'U',
+                    pc->shard, pc->rec.id, pc->rec.name, pc->rec.programme, pc->rec.mark);
+    }
+    fputs("COMMIT\n", fp);
+    int err = ferror(fp) ? EIO : sync ? syncFile(fp) : (fflush(fp) != 0 ? (errno ? errno : EIO) : 0); //the one sync of the whole transaction
+    if (err) { //drop the torn block
+        fflush(fp);
+#ifdef _WIN32
+        _chsize(_fileno(fp), start);
+#else
+        if (ftruncate(fileno(fp), start) != 0) err = errno;
+#endif
+    } else {
+        db->journalBytes = (size_t)ftell(fp);
+    }
+    if (fclose(fp) != 0 && !err) err = errno ? errno : EIO;
+    return err;
+}
+
+// Helper: journal a change made outside a transaction while the journal holds blocks, returns 0 or an errno value
+// replay applies every block over the files, so once a block is journaled each later change has to follow it there,
+// or replaying the block over a file that already holds the change would undo it
+// these blocks are not synced one by one, syncJournal() runs before any file is replaced
+static int journalChange(Database *db, ChangeOp op, size_t shard, const Student *rec) {
+    if (db->journalBytes == 0) return 0; //nothing to replay, the files are the only copy
+    PendingChange pc;
+    memset(&pc, 0, sizeof pc);
+    pc.id = rec->id;
+    pc.op = op;
+    pc.shard = shard;
+    pc.rec = *rec;
+    return writeJournal(db, &pc, 1, 0);
+}
+
+// Helper: sync the journal at path before a file is replaced, so every change the file holds is in the journal as well
+// returns 0 or an errno value
+static int syncJournal(const char *path) {
+    if (path[0] == '\0') return 0; //nothing was opened, so there is no journal
+    FILE *fp = fopen(path, "r+b");
+    if (!fp) return (errno == ENOENT) ? 0 : (errno ? errno : EIO); //no journal, nothing to sync
+    int err = syncFile(fp);
+    if (fclose(fp) != 0 && !err) err = errno ? errno : EIO;
+    return err;
+}
+
+// Helper: close the gaps deleted rows leave in a shard in one pass, moved rows keep their index entries
+static void compactShard(Database *db, size_t s, const unsigned char *gone, size_t goneRows, size_t first) {
+    Shard *sh = &db->shards[s];
+    size_t kept = first;
+    for (size_t r = first; r < sh->count; r++) {
+        if (r < goneRows && gone[r]) continue;
+        if (kept != r) {
+            *rowAt(sh, kept) = *rowAt(sh, r);
+            IdSlot *moved = idFind(db, rowAt(sh, kept)->id);
+            if (moved && moved->shard == s && moved->row == r) moved->row = kept;
+        }
+        kept++;
+    }
+    size_t before = sh->count;
+    sh->count = kept;
+    trimChunks(sh, before);
+}
+
+// Helper: apply every buffered change at once, the database lock must be held
+// every allocation is made and the journal block synced before the first row changes, so a failure leaves the table untouched
+// returns the number of records changed or a DbError
+static long applyTransaction(Database *db, int journal) {
+    Transaction *t = &db->txn;
+    size_t inserts[MAX_SHARDS] = {0}, reserved[MAX_SHARDS] = {0}, firstGone[MAX_SHARDS], goneRows[MAX_SHARDS] = {0};
+    unsigned char *gone[MAX_SHARDS] = {0};
+    size_t shards = db->shardCount ? db->shardCount : 1; //inserts into a database that was never opened go to shard 0
+    size_t newIds = 0, changes = 0;
+    int rc = DB_OK;
+    for (size_t s = 0; s < MAX_SHARDS; s++) firstGone[s] = (size_t)-1;
+
+    // net operation per ID, and what it needs from each shard
+    for (size_t k = 0; k < t->count; k++) {
+        PendingChange *pc = &t->changes[k];
+        IdSlot *slot = idFind(db, pc->id);
+        const Student *cur = slot ? rowAt(&db->shards[slot->shard], slot->row) : NULL;
+        if (pc->present && !cur) pc->op = CHANGE_INSERT;
+        else if (!pc->present && cur) pc->op = CHANGE_DELETE;
+        else if (cur && (strcmp(cur->name, pc->rec.name) != 0 || strcmp(cur->programme, pc->rec.programme) != 0 || cur->mark != pc->rec.mark))
+            pc->op = CHANGE_UPDATE;
+        else pc->op = -1; //inserted and deleted again, or changed back
+        if (pc->op < 0) continue;
+        changes++;
+
+        if (pc->op == CHANGE_INSERT) {
+            inserts[pc->shard]++;
+            newIds++;
+        } else if (pc->op == CHANGE_UPDATE) {
+            if (ownChunks(&db->shards[slot->shard], slot->row, slot->row) != 0) rc = DB_ERR_NO_MEMORY;
+        } else if (slot->row < firstGone[slot->shard]) {
+            firstGone[slot->shard] = slot->row;
+        }
+    }
+
+    // reserve everything up front: index slots, log entries, private chunks and room for new rows
+    if (rc == DB_OK && idReserve(db, db->idUsed + newIds) != 0) rc = DB_ERR_NO_MEMORY;
+    for (size_t s = 0; s < shards && rc == DB_OK; s++) {
+        Shard *sh = &db->shards[s];
+        if (firstGone[s] != (size_t)-1) { //every row after the first deleted one moves
+            goneRows[s] = sh->count;
+            gone[s] = dbZalloc(db, sh->count);
+            if (!gone[s] || ownChunks(sh, firstGone[s], sh->count - 1) != 0) rc = DB_ERR_NO_MEMORY;
+        }
+        if (rc == DB_OK && inserts[s]) {
+            if (sh->count % CHUNK_ROWS != 0 && ownChunks(sh, sh->count - 1, sh->count - 1) != 0) rc = DB_ERR_NO_MEMORY;
+            else if (reserveRows(sh, inserts[s], db->snapEpoch) != 0) rc = DB_ERR_NO_MEMORY;
+            else reserved[s] = inserts[s];
+        }
+    }
+    if (reserveChanges(db, changes) != 0) db->changeLogFailed = 1; //only EXPORT CHANGES needs the log
+    if (rc == DB_OK && journal && changes > 0) {
+        int err = writeJournal(db, t->changes, t->count, 1);
+        if (err) {
+            errno = err;
+            rc = DB_ERR_IO;
+        }
+    }
+    if (rc != DB_OK) {
+        for (size_t s = 0; s < shards; s++) {
+            if (reserved[s]) trimChunks(&db->shards[s], db->shards[s].count + reserved[s]);
+            dbFree(db, gone[s]);
+        }
+        return rc;
+    }
+
+    // apply, nothing below can fail so every change lands; the name index drops itself if it cannot grow
+    for (size_t k = 0; k < t->count; k++) {
+        const PendingChange *pc = &t->changes[k];
+        if (pc->op == CHANGE_UPDATE) {
+            IdSlot *slot = idFind(db, pc->id);
+            Student *rec = rowAt(&db->shards[slot->shard], slot->row);
+            if (strcmp(rec->name, pc->rec.name) != 0) nameChanged(db, slot, pc->rec.name);
+            memcpy(rec->name, pc->rec.name, sizeof rec->name);
+            memcpy(rec->programme, pc->rec.programme, sizeof rec->programme);
+            rec->mark = pc->rec.mark;
+            rec->grade = pc->rec.grade;
+        } else if (pc->op == CHANGE_INSERT) {
+            Shard *sh = &db->shards[pc->shard];
+            *rowAt(sh, sh->count) = pc->rec;
+            idPut(db, pc->id, pc->shard, sh->count++);
+            nameChanged(db, idFind(db, pc->id), pc->rec.name);
+        } else if (pc->op == CHANGE_DELETE) {
+            IdSlot *slot = idFind(db, pc->id);
+            gone[slot->shard][slot->row] = 1;
+            idRemove(db, pc->id);
+            nameRemoved(db);
+        }
+    }
+    for (size_t k = 0; k < t->count; k++) { //deletes are logged below, once every insert is in place
+        const PendingChange *pc = &t->changes[k];
+        if (pc->op != CHANGE_UPDATE && pc->op != CHANGE_INSERT) continue;
+        IdSlot *slot = idFind(db, pc->id);
+        logChange(db, (ChangeOp)pc->op, pc->id, slot->shard, slot->row);
+    }
+    if (newIds && db->shardCount == 0) db->shardCount = 1; //first records of a database that was never opened
+    for (size_t s = 0; s < shards; s++) {
+        if (!gone[s]) continue;
+        for (size_t r = goneRows[s]; r-- > firstGone[s];) //last row first, so every logged row is still where it was
+            if (gone[s][r]) logChange(db, CHANGE_DELETE, rowAt(&db->shards[s], r)->id, s, r);
+        compactShard(db, s, gone[s], goneRows[s], firstGone[s]);
+        dbFree(db, gone[s]);
+    }
+    for (size_t k = 0; db->duplicates && k < t->count; k++) //rows are in their final places now
+        if (t->changes[k].op == CHANGE_DELETE) idRestore(db, t->changes[k].id);
+    return (long)changes;
+}
+
+// Helper: buffer one journal record as an INSERT, UPDATE or DELETE of the record as it is now
+// records hold whole rows, so replaying a block the files already contain changes nothing
+// shards maps the shard numbers of the block to the shards open now, -1 where the block named no file
+static int replayRecord(Database *db, const char *line, const long *shards) {
+    char op;
+    size_t shard;
+    int n = 0;
+    Student s;
+    if (sscanf(line, "%c\t%zu\t%n", &op, &shard, &n) != 2 || n == 0) return DB_ERR_INVALID_ARGUMENT;
+    if (shard >= MAX_SHARDS || shards[shard] < 0) return DB_ERR_INVALID_ARGUMENT; //the block never said which file this is
+    if (op == 'D') {
+        int id = atoi(line + n);
+        return txnVisible(db, id) ? stageDelete(db, id) : DB_OK;
+    }
+    if ((op != 'I' && op != 'U') || !parseRecordLine(line + n, &s)) return DB_ERR_INVALID_ARGUMENT;
+    if (txnVisible(db, s.id)) return stageUpdate(db, &s);
+    return stageInsert(db, (size_t)shards[shard], &s);
+}
+
+// Helper: read a "FILE\t<shard>\t<path>" line of a journal block, returns 1 if the line is one
+static int parseFileLine(const char *line, size_t *shard, char *path, size_t n) {
+    int start = 0;
+    if (sscanf(line, "FILE\t%zu\t%n", shard, &start) != 1 || start == 0) return 0;
+    snprintf(path, n, "%s", line + start);
+    path[strcspn(path, "\r\n")] = '\0';
+    return 1;
+}
+
+// Helper: 1 if two paths name the same file, so "./a.txt" and "a.txt" match
+static int sameFile(const char *a, const char *b) {
+    if (strcmp(a, b) == 0) return 1;
+#ifdef _WIN32
+    return 0;
+#else
+    struct stat sa, sb;
+    return stat(a, &sa) == 0 && stat(b, &sb) == 0 && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+#endif
+}
+
+// Helper: position of a path among the files being opened, -1 if it is not one of them
+static long findOpened(const char *path, const char *const *paths, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        if (sameFile(path, paths[i])) return (long)i;
+    return -1;
+}
+
+// Helper: DB_OK if the journals next to the files can be replayed onto them, checked before anything is loaded
+// only the first file's journal is replayed, so a journal next to another file was left by opening the files in another
+// order, and a block naming a file that is not opened with it would lose its changes; both are refused instead
+// OPEN LAZY never replays, so it refuses any journal that is not empty rather than show rows from before its commits
+static int checkJournals(char (*paths)[512], size_t n, int lazy) {
+    const char *names[MAX_SHARDS];
+    char path[528], line[1024], file[512];
+    size_t shard;
+    for (size_t i = 0; i < n; i++) names[i] = paths[i];
+    for (size_t i = 0; i < n; i++) {
+        if ((size_t)snprintf(path, sizeof path, "%s.journal", paths[i]) >= sizeof path) continue;
+        FILE *fp = fopen(path, "r");
+        if (!fp) continue; //no unsaved transactions
+        int rc = DB_OK;
+        while (rc == DB_OK && fgets(line, sizeof line, fp)) {
+            if (lazy) rc = DB_ERR_JOURNAL_PENDING;
+            else if (i > 0) rc = DB_ERR_JOURNAL_MISMATCH;
+            else if (parseFileLine(line, &shard, file, sizeof file) && findOpened(file, names, n) < 0) rc = DB_ERR_JOURNAL_MISMATCH;
+        }
+        fclose(fp);
+        if (rc != DB_OK) return rc;
+    }
+    return DB_OK;
+}
+
+// Helper: apply every committed block left in the journal by an earlier session, the database lock must be held
+static void replayJournal(Database *db) {
+    char path[528], line[1024], file[512];
+    const char *names[MAX_SHARDS];
+    long shards[MAX_SHARDS];
+    size_t shard;
+    FILE *fp = journalPath(db, path, sizeof path) ? fopen(path, "r") : NULL;
+    for (size_t i = 0; i < db->shardCount; i++) names[i] = db->shards[i].path;
+    db->txnStats.recovered = 0;
+    db->journalBytes = 0;
+    if (!fp) return; //no journal, every change is in the files
+
+    int inBlock = 0;
+    while (fgets(line, sizeof line, fp)) {
+        if (strncmp(line, "BEGIN", 5) == 0) {
+            clearTransaction(db);
+            for (size_t i = 0; i < MAX_SHARDS; i++) shards[i] = -1;
+            inBlock = 1;
+        } else if (!inBlock) {
+            continue; //rest of a block that could not be read
+        } else if (parseFileLine(line, &shard, file, sizeof file)) {
+            if (shard < MAX_SHARDS) shards[shard] = findOpened(file, names, db->shardCount); //checkJournals() made sure it is open
+        } else if (strncmp(line, "COMMIT", 6) == 0) {
+            if (applyTransaction(db, 0) >= 0) db->txnStats.recovered++;
+            clearTransaction(db);
+            inBlock = 0;
+        } else if (replayRecord(db, line, shards) != DB_OK) { //damaged block, skipped as a whole
+            clearTransaction(db);
+            inBlock = 0;
+        }
+    }
+    clearTransaction(db); //a block without COMMIT was never applied
+    db->journalBytes = (size_t)ftell(fp);
+    fclose(fp);
+}
+
+int db_begin(Database *db) {
+    if (db->lazyMode) return DB_ERR_READ_ONLY;
+    pthread_mutex_lock(&db->lock);
+    int rc = db->txn.open ? DB_ERR_IN_TRANSACTION : DB_OK;
+    db->txn.open = 1;
+    pthread_mutex_unlock(&db->lock);
+    return rc;
+}
+
+int db_commit(Database *db) {
+    struct timespec t0, t1;
+    pthread_mutex_lock(&db->lock); //autosave never sees half a transaction
+    if (!db->txn.open) {
+        pthread_mutex_unlock(&db->lock);
+        return DB_ERR_NO_TRANSACTION;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    long changes = applyTransaction(db, 1);
+    if (changes >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        db->txnStats.commits++;
+        db->txnStats.lastChanges = (size_t)changes;
+        db->txnStats.lastCommitMs = elapsedUs(&t0, &t1) / 1e3;
+        clearTransaction(db);
+    }
+    pthread_mutex_unlock(&db->lock);
+    return changes >= 0 ? DB_OK : (int)changes;
+}
+
+int db_rollback(Database *db) {
+    pthread_mutex_lock(&db->lock);
+    int rc = db->txn.open ? DB_OK : DB_ERR_NO_TRANSACTION;
+    if (rc == DB_OK) { //nothing was applied, so there is nothing to undo
+        clearTransaction(db);
+        db->txnStats.rollbacks++;
+    }
+    pthread_mutex_unlock(&db->lock);
+    return rc;
+}
+
+void db_txn_stats(Database *db, TxnStats *out) {
+    pthread_mutex_lock(&db->lock);
+    *out = db->txnStats;
+    out->open = db->txn.open;
+    out->pending = db->txn.count;
+    pthread_mutex_unlock(&db->lock);
+}
+
+// =====================================================
+// CREATE / CLOSE / DESTROY
+// =====================================================
+Database *db_create(const DbAllocator *allocator) {
+    DbAllocator mem = {stdAlloc, stdResize, stdRelease, NULL};
+    if (allocator) { //hooks left NULL keep the standard ones
+        if (allocator->alloc) mem.alloc = allocator->alloc;
+        if (allocator->resize) mem.resize = allocator->resize;
+        if (allocator->release) mem.release = allocator->release;
+        mem.ctx = allocator->ctx;
+    }
+
+    Database *db = mem.alloc(mem.ctx, sizeof *db);
+    if (!db) return NULL;
+    memset(db, 0, sizeof *db);
+    db->mem = mem;
+    db->activeField = -1;
+    db->activeAscending = 1;
+    db->shards = dbZalloc(db, MAX_SHARDS * sizeof *db->shards); //each shard carries its own decode cache, too big to embed
+    if (!db->shards) {
+        mem.release(mem.ctx, db);
+        return NULL;
+    }
+    for (size_t i = 0; i < MAX_SHARDS; i++) db->shards[i].db = db;
+    pthread_mutex_init(&db->lock, NULL);
+    pthread_mutex_init(&db->fileLock, NULL);
+    pthread_cond_init(&db->autosave.wake, NULL);
+    return db;
+}
+
+// Helper: free every shard, the ID index, views and change log, the database lock must be held
+static void closeShards(Database *db) {
+    for (size_t i = 0; i < db->shardCount; i++) freeShard(&db->shards[i]);
+    db->shardCount = 0;
+    db->lazyMode = 0;
+    db->duplicates = 0;
+    db->unsaved = 0; //nothing opened next is unsaved yet
+    clearTransaction(db); //buffered changes belong to the rows being closed
+    db->journalBytes = 0; //the journal stays on disk for the next OPEN of these files
+    db->journalGen++;
+    clearViews(db);
+    freeNameIndex(db); //built again by the next OPEN
+    clearChanges(db); //changes are relative to the files that were open
+    dbFree(db, db->idIndex);
+    db->idIndex = NULL;
+    db->idCap = db->idUsed = 0;
+}
+
+void db_close(Database *db) {
+    pthread_mutex_lock(&db->lock);
+    closeShards(db);
+    pthread_mutex_unlock(&db->lock);
+}
+
+void db_destroy(Database *db) {
+    if (!db) return;
+    db_autosave_stop(db);
+    db_close(db);
+    pthread_cond_destroy(&db->autosave.wake);
+    pthread_mutex_destroy(&db->fileLock);
+    pthread_mutex_destroy(&db->lock);
+    dbFree(db, db->shards);
+    db->mem.release(db->mem.ctx, db);
+}
+
+// =====================================================
+// OPEN DATABASE (.txt)
+// =====================================================
+// Helper: read every row of the shard's file into memory, returns 0 or an errno value
+static int loadShardFull(Shard *sh) {
+    char line[512];
+    FILE *fp = fopen(sh->path, "r");
+    if (!fp) return errno ? errno : ENOENT; //file cant be opened
+
+    // Skip header until "ID"
+    while (fgets(line, sizeof(line), fp)) {
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++; //skip leading spaces or tabs
+        if (strncmp(p, "ID", 2) == 0) break; //stop when a line starting with ID is found
+    }
+
+    while (fgets(line, sizeof(line), fp)) { //read each student record line by line
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++; //skip whitespace at the start
+        if (!isdigit((unsigned char)*p)) continue; //if the line does not start with a digit, skip it
+
+        Student s;
+        if (parseRecordLine(line, &s) && appendRow(sh, &s, 0) != 0) { //not published yet, no snapshot can share it
+            fclose(fp);
+            return ENOMEM;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+// Helper: map the whole file read-only, returns 0 or an errno value
+static int mapShardFile(Shard *sh) {
+#ifdef _WIN32
+    sh->mapFile = CreateFileA(sh->path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (sh->mapFile == INVALID_HANDLE_VALUE) return ENOENT;
+    LARGE_INTEGER size;
+    GetFileSizeEx(sh->mapFile, &size);
+    sh->mapSize = (size_t)size.QuadPart;
+    if (sh->mapSize == 0) { CloseHandle(sh->mapFile); return 0; } //empty files cannot be mapped but are still valid
+    sh->mapHandle = CreateFileMappingA(sh->mapFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!sh->mapHandle) { CloseHandle(sh->mapFile); return EIO; }
+    sh->mapBase = MapViewOfFile(sh->mapHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!sh->mapBase) { CloseHandle(sh->mapHandle); CloseHandle(sh->mapFile); return EIO; }
+#else
+    int fd = open(sh->path, O_RDONLY);
+    if (fd < 0) return errno;
+    struct stat st;
+    if (fstat(fd, &st) != 0) { int err = errno; close(fd); return err; }
+    sh->mapSize = (size_t)st.st_size;
+    if (sh->mapSize > 0) {
+        void *p = mmap(NULL, sh->mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) { int err = errno; close(fd); return err; }
+        sh->mapBase = p;
+    }
+    close(fd); //the mapping stays valid after the descriptor is closed
+#endif
+    return 0;
+}
+
+// Helper: stable merge sort of row numbers by student ID, tmp must hold n entries
+static void mergeSortById(const RowIndex *ri, unsigned *order, unsigned *tmp, size_t n) {
+    if (n < 2) return;
+    size_t mid = n / 2;
+    mergeSortById(ri, order, tmp, mid);
+    mergeSortById(ri, order + mid, tmp, n - mid);
+
+    size_t i = 0, j = mid, k = 0;
+    while (i < mid && j < n) //take from the left half on ties so equal IDs keep their file order
+        tmp[k++] = (ri[order[j]].id < ri[order[i]].id) ? order[j++] : order[i++];
+    while (i < mid) tmp[k++] = order[i++];
+    while (j < n) tmp[k++] = order[j++];
+    memcpy(order, tmp, n * sizeof *order);
+}
+
+// Helper: map the shard's file and index where each row starts, returns 0 or an errno value
+static int loadShardLazy(Shard *sh) {
+    char line[512];
+    int err = mapShardFile(sh);
+    if (err) return err;
+
+    // Skip header until "ID"
+    size_t pos = 0, next;
+    while (pos < sh->mapSize) {
+        const char *p = mappedLine(sh, pos, &next, line, sizeof line);
+        pos = next;
+        while (*p == ' ' || *p == '\t') p++; //skip leading spaces or tabs
+        if (strncmp(p, "ID", 2) == 0) break; //stop when a line starting with ID is found
+    }
+
+    // first pass only remembers where each valid row starts
+    size_t cap = 0;
+    while (pos < sh->mapSize) {
+        size_t start = pos;
+        const char *p = mappedLine(sh, pos, &next, line, sizeof line);
+        pos = next;
+        while (*p == ' ' || *p == '\t') p++; //skip whitespace at the start
+        if (!isdigit((unsigned char)*p)) continue; //if the line does not start with a digit, skip it
+
+        Student s;
+        if (!parseRecordLine(line, &s)) continue; //rows that a full OPEN would skip are skipped here too
+        if (sh->count == cap) { //grow the index geometrically
+            cap = cap ? cap * 2 : 256;
+            RowIndex *grown = dbResize(sh->db, sh->rowIndex, cap * sizeof *grown);
+            if (!grown) return ENOMEM;
+            sh->rowIndex = grown;
+        }
+        sh->rowIndex[sh->count].id = s.id;
+        sh->rowIndex[sh->count].offset = start;
+        sh->count++;
+    }
+
+    // second, smaller array sorted by ID so QUERY can binary search
+    size_t n = sh->count ? sh->count : 1;
+    unsigned *tmp = dbAlloc(sh->db, n * sizeof *tmp);
+    sh->idOrder = dbAlloc(sh->db, n * sizeof *sh->idOrder);
+    if (!tmp || !sh->idOrder) {
+        dbFree(sh->db, tmp);
+        return ENOMEM;
+    }
+    for (size_t i = 0; i < sh->count; i++) sh->idOrder[i] = (unsigned)i;
+    mergeSortById(sh->rowIndex, sh->idOrder, tmp, sh->count);
+    dbFree(sh->db, tmp);
+    return 0;
+}
+
+static void loadShardJob(Shard *sh, void *arg) {
+    int *err = arg;
+    *err = sh->lazy ? loadShardLazy(sh) : loadShardFull(sh);
+}
+
+// Helper: add one path (or every match of a wildcard pattern) to the list, returns -1 if the list is full
+static int addPath(const char *pattern, char paths[][512], size_t *n) {
+#ifndef _WIN32
+    glob_t g;
+    if (strpbrk(pattern, "*?[") && glob(pattern, 0, NULL, &g) == 0) {
+        for (size_t i = 0; i < g.gl_pathc; i++) {
+            if (*n == MAX_SHARDS) { globfree(&g); return -1; }
+            snprintf(paths[(*n)++], 512, "%s", g.gl_pathv[i]);
+        }
+        globfree(&g);
+        return 0;
+    }
+#endif
+    if (*n == MAX_SHARDS) return -1;
+    snprintf(paths[(*n)++], 512, "%s", pattern); //plain path, or a pattern without matches so fopen reports it
+    return 0;
+}
+
+// Helper: split a comma separated list of paths and patterns, returns the number of paths or -1
+static long splitPaths(const char *list, char paths[][512]) {
+    char item[512], clean[512];
+    size_t n = 0;
+    while (*list) {
+        const char *start = list;
+        size_t len = strcspn(list, ","); //one entry up to the next comma, strtok is avoided so handles stay reentrant
+        list += len;
+        if (*list == ',') list++;
+
+        while (len && (*start == ' ' || *start == '\t')) { start++; len--; } //trim spaces around each entry
+        while (len && (start[len - 1] == ' ' || start[len - 1] == '\t')) len--;
+        if (len == 0) continue;
+        if (len >= sizeof item) len = sizeof item - 1;
+        memcpy(item, start, len);
+        item[len] = '\0';
+        clean_path(item, clean, sizeof clean); //remove surrounding quotes
+        if (addPath(clean, paths, &n) != 0) return -1;
+    }
+    return (long)n;
+}
+
+// Helper: load every file into its own shard in parallel, nothing changes unless all files load
+static int openFiles(Database *db, const char *list, int lazy) {
+    char (*paths)[512] = dbAlloc(db, MAX_SHARDS * sizeof *paths);
+    Shard *loaded = dbZalloc(db, MAX_SHARDS * sizeof *loaded); //each shard carries its own decode cache, too big for the stack
+    int errs[MAX_SHARDS];
+    int rc = DB_OK;
+    long n = 0;
+
+    if (db->txn.open) { //the open transaction would lose its changes
+        rc = DB_ERR_IN_TRANSACTION;
+    } else if (!paths || !loaded) {
+        errno = ENOMEM;
+        rc = DB_ERR_NO_MEMORY;
+    } else if ((n = splitPaths(list, paths)) < 0) {
+        errno = E2BIG;
+        rc = DB_ERR_TOO_MANY_FILES;
+    } else if (n == 0) {
+        errno = ENOENT;
+        rc = DB_ERR_IO;
+    } else {
+        rc = checkJournals(paths, (size_t)n, lazy); //refused before loading, so the database that is open stays open
+    }
+
+    if (rc == DB_OK) {
+        for (long i = 0; i < n; i++) {
+            loaded[i].db = db;
+            snprintf(loaded[i].path, sizeof loaded[i].path, "%s", paths[i]);
+            loaded[i].lazy = lazy;
+        }
+        runParallel(loaded, (size_t)n, loadShardJob, errs, sizeof errs[0]);
+
+        for (long i = 0; i < n && rc == DB_OK; i++) {
+            if (errs[i] == 0) continue;
+            errno = errs[i];
+            rc = (errs[i] == ENOMEM) ? DB_ERR_NO_MEMORY : DB_ERR_IO;
+        }
+        if (rc != DB_OK) { //keep the current database if any file failed
+            pthread_mutex_lock(&db->lock);
+            for (long i = 0; i < n; i++) freeShard(&loaded[i]);
+            pthread_mutex_unlock(&db->lock);
+        } else { //replace the current database
+            pthread_mutex_lock(&db->lock);
+            closeShards(db);
+            memcpy(db->shards, loaded, (size_t)n * sizeof *loaded);
+            db->shardCount = (size_t)n;
+            db->lazyMode = lazy;
+            if (rebuildIdIndex(db) != 0) {
+                closeShards(db);
+                errno = ENOMEM;
+                rc = DB_ERR_NO_MEMORY;
+            } else if (!lazy) {
+                replayJournal(db); //transactions committed after the files were last saved
+                buildNameIndex(db); //so the first FIND NAME does not pay for it, without memory that search builds it instead
+            }
+            pthread_mutex_unlock(&db->lock);
+        }
+    }
+    dbFree(db, loaded);
+    dbFree(db, paths);
+    return rc;
+}
+
+int db_open(Database *db, const char *paths) {
+    return openFiles(db, paths, 0);
+}
+
+int db_open_lazy(Database *db, const char *paths) {
+    return openFiles(db, paths, 1);
+}
+
+int db_is_lazy(const Database *db) {
+    return db->lazyMode;
+}
+
+size_t db_duplicate_count(const Database *db) {
+    return db->duplicates;
+}
+
+// =====================================================
+// QUERY
+// =====================================================
+const Student *db_query(Database *db, int id) {
+    if (db->txn.open) return txnVisible(db, id); //sees the changes the open transaction buffered
+    size_t shard, row;
+    return locateId(db, id, &shard, &row) ? shardRow(&db->shards[shard], row) : NULL; //the ID index knows which shard holds the ID
+}
+
+// =====================================================
+// UPDATE
+// =====================================================
+static int updateRecord(Database *db, const Student *s) {
+    if (db->lazyMode) return DB_ERR_READ_ONLY;
+    IdSlot *slot = idFind(db, s->id); //checks if the student exists
+    if (!slot) return DB_ERR_NOT_FOUND;
+    int rc = checkFields(s);
+    if (rc != DB_OK) return rc;
+
+    Shard *sh = &db->shards[slot->shard];
+    Student *rec = rowAt(sh, slot->row);
+    if (strcmp(rec->name, s->name) == 0 && strcmp(rec->programme, s->programme) == 0 && rec->mark == s->mark)
+        return DB_OK; //nothing changed, so there is nothing to export or re-sort
+    if (ownChunks(sh, slot->row, slot->row) != 0) return DB_ERR_NO_MEMORY; //an autosave snapshot keeps the old row
+    Student next = *rec;
+    snprintf(next.name, sizeof next.name, "%s", s->name);
+    snprintf(next.programme, sizeof next.programme, "%s", s->programme);
+    next.mark = s->mark;
+    next.grade = getGrade(next.mark); //recalculate grade after mark update
+    int err = journalChange(db, CHANGE_UPDATE, slot->shard, &next);
+    if (err) {
+        errno = err;
+        return DB_ERR_IO;
+    }
+    rec = rowAt(sh, slot->row);
+    int renamed = strcmp(rec->name, next.name) != 0;
+    *rec = next;
+    if (renamed) nameChanged(db, slot, rec->name);
+    logChange(db, CHANGE_UPDATE, rec->id, slot->shard, slot->row);
+    return DB_OK;
+}
+
+int db_update(Database *db, const Student *s) {
+    pthread_mutex_lock(&db->lock); //the autosave writer may be sharing this row's chunk
+    int rc = db->txn.open ? stageUpdate(db, s) : updateRecord(db, s); //inside a transaction the change waits for COMMIT
+    pthread_mutex_unlock(&db->lock);
+    return rc;
+}
+
+// =====================================================
+// INSERT
+// =====================================================
+static int insertRecord(Database *db, size_t shard, const Student *s) {
+    if (db->lazyMode) return DB_ERR_READ_ONLY;
+    if (shard >= (db->shardCount ? db->shardCount : 1)) return DB_ERR_INVALID_ARGUMENT; //a database that was never opened only has shard 0
+    if (s->id < 1000000 || s->id > 9999999) return DB_ERR_INVALID_ID; //check that ID is exactly 7 digits and cannot start with 0
+    if (idFind(db, s->id)) return DB_ERR_DUPLICATE; //prevent duplicate IDs across every shard
+    int rc = checkFields(s);
+    if (rc != DB_OK) return rc;
+
+    Student rec = *s;
+    rec.grade = getGrade(rec.mark); //calculation of grade
+
+    Shard *sh = &db->shards[shard];
+    if (sh->count % CHUNK_ROWS != 0 && ownChunks(sh, sh->count - 1, sh->count - 1) != 0) //never write into a chunk the snapshot is reading
+        return DB_ERR_NO_MEMORY;
+    if (appendRow(sh, &rec, db->snapEpoch) != 0) return DB_ERR_NO_MEMORY;
+    if (idPut(db, rec.id, shard, sh->count - 1) < 0) {
+        dropLastRow(sh);
+        return DB_ERR_NO_MEMORY;
+    }
+    int err = journalChange(db, CHANGE_INSERT, shard, &rec);
+    if (err) { //the row is only kept once it is journaled
+        idRemove(db, rec.id);
+        dropLastRow(sh);
+        errno = err;
+        return DB_ERR_IO;
+    }
+    if (db->shardCount == 0) db->shardCount = 1; //first record of a database that was never opened
+    nameChanged(db, idFind(db, rec.id), rec.name);
+    logChange(db, CHANGE_INSERT, rec.id, shard, sh->count - 1);
+    return DB_OK;
+}
+
+int db_insert(Database *db, size_t shard, const Student *s) {
+    pthread_mutex_lock(&db->lock); //the autosave writer may be sharing the shard's last chunk
+    int rc = db->txn.open ? stageInsert(db, shard, s) : insertRecord(db, shard, s);
+    pthread_mutex_unlock(&db->lock);
+    return rc;
+}
+
+// =====================================================
+// DELETE
+// =====================================================
+static int deleteRecord(Database *db, int id) {
+    if (db->lazyMode) return DB_ERR_READ_ONLY;
+    IdSlot *slot = idFind(db, id); //search for the record with the matching ID
+    if (!slot) return DB_ERR_NOT_FOUND; //ID does not exist in any shard
+
+    size_t s = slot->shard, i = slot->row;
+    Shard *sh = &db->shards[s];
+    if (ownChunks(sh, i, sh->count - 1) != 0) return DB_ERR_NO_MEMORY; //every row from here on moves
+    int err = journalChange(db, CHANGE_DELETE, s, rowAt(sh, i));
+    if (err) {
+        errno = err;
+        return DB_ERR_IO;
+    }
+    idRemove(db, id);
+    nameRemoved(db);
+    logChange(db, CHANGE_DELETE, id, s, i);
+    for (size_t j = i + 1; j < sh->count; j++) { //shift all records after this index one step left to close the gap
+        *rowAt(sh, j - 1) = *rowAt(sh, j);
+        IdSlot *moved = idFind(db, rowAt(sh, j - 1)->id);
+        if (moved && moved->shard == s && moved->row == j) moved->row = j - 1; //keep the index pointing at the moved row
+    }
+    dropLastRow(sh); //reduce count since one record got removed
+    idRestore(db, id); //another row may hold the same ID
+    return DB_OK;
+}
+
+int db_delete(Database *db, int id) {
+    pthread_mutex_lock(&db->lock); //the autosave writer may be sharing the chunks that shift
+    int rc = db->txn.open ? stageDelete(db, id) : deleteRecord(db, id);
+    pthread_mutex_unlock(&db->lock);
+    return rc;
+}
+
+// =====================================================
+// SAVE DATABASE (.txt)
+// =====================================================
+// header and record lines of the tab separated format
+static const char fileHeader[] = "ID\tName\tProgramme\tMark\n";
+
+static void writeRecord(FILE *fp, const Student *st) {
+    fprintf(fp, "%d\t%s\t%s\t%.1f\n", st->id, st->name, st->programme, st->mark);
+}
+
+// Helper: write rows in the tab separated format, returns 0 on success
+// only limits the output to one shard, view keeps the last db_sort() order
+static int writeRows(Database *db, FILE *fp, const Shard *only, const SortView *view) {
+    //saves the header as well as the student records in tab-separated format into the file
+    fputs(fileHeader, fp);
+    RowCursor c = {view, 0, 0, 0};
+    size_t row;
+    long s;
+    while ((s = nextRow(db, &c, &row)) >= 0) {
+        if (only && &db->shards[s] != only) continue;
+        const Student *st = shardRow(&db->shards[s], row);
+        if (!st) return -1; //a mapped line no longer parses, the file changed underneath it
+        writeRecord(fp, st);
+    }
+    return ferror(fp) ? -1 : 0;
+}
+
+// Helper: open "<path>.tmp" for writing, the real file is only replaced by commitTemp()
+static FILE *openTemp(const char *path, char *tmp, size_t n) {
+    if ((size_t)snprintf(tmp, n, "%s.tmp", path) >= n) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    return fopen(tmp, "w");
+}
+
+// Helper: flush the temp file to disk and rename it over path, so readers see the old or the new file but never half of one
+// returns 0 or an errno value, the temp file is removed on failure
+static int commitTemp(FILE *fp, const char *tmp, const char *path, int failed) {
+    int err = failed ? EIO : 0;
+    if (!err) err = syncFile(fp);
+    if (fclose(fp) != 0 && !err) err = errno ? errno : EIO;
+#ifdef _WIN32
+    if (!err && !MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) err = EIO;
+#else
+    if (!err && rename(tmp, path) != 0) err = errno ? errno : EIO;
+#endif
+    if (err) remove(tmp);
+    return err;
+}
+
+int db_save_as(Database *db, const char *path) {
+    char clean[512];  //variable to hold cleaned path
+
+    // if path is NULL or empty, return error and exit function
+    if (!path || path[0] == '\0') return DB_ERR_NO_PATH;
+
+    //calling clean_path function to sanitize the input path
+    clean_path(path, clean, sizeof clean);
+    for (size_t i = 0; db->lazyMode && i < db->shardCount; i++) {
+        if (strcmp(clean, db->shards[i].path) != 0) continue;
+        if (db->shardCount == 1) return DB_OK; //a lazily opened file is read-only, so it is already up to date
+        return DB_ERR_READ_ONLY; //mapped by OPEN LAZY and cannot be overwritten
+    }
+    char tmp[520];
+    pthread_mutex_lock(&db->fileLock); //an autosave may be renaming over the same file
+    FILE *fp = openTemp(clean, tmp, sizeof tmp);
+    int err = fp ? commitTemp(fp, tmp, clean, writeRows(db, fp, NULL, currentView(db)) != 0) : errno; //every shard merged into one file
+    pthread_mutex_unlock(&db->fileLock);
+    if (err) errno = err;
+    return err ? DB_ERR_IO : DB_OK;
+}
+
+typedef struct {
+    const SortView *view;  //order the rows are written in, only read by the jobs
+    int err;
+} SaveArgs;
+
+static void saveShardJob(Shard *sh, void *arg) {
+    SaveArgs *a = arg;
+    a->err = 0;
+    if (sh->lazy) return; //mapped files are never modified
+    char tmp[520];
+    FILE *fp = openTemp(sh->path, tmp, sizeof tmp);
+    if (!fp) { a->err = errno ? errno : EIO; return; }
+    a->err = commitTemp(fp, tmp, sh->path, writeRows(sh->db, fp, sh, a->view) != 0);
+}
+
+int db_save(Database *db) {
+    SaveArgs args[MAX_SHARDS];
+    for (size_t i = 0; i < db->shardCount; i++)
+        if (db->shards[i].path[0] == '\0') return DB_ERR_NO_PATH; //rows inserted before any file was opened
+    if (db->shardCount == 0) return DB_OK;
+
+    const SortView *view = currentView(db); //brought up to date here because the jobs only read it
+    for (size_t i = 0; i < db->shardCount; i++) args[i].view = view;
+    pthread_mutex_lock(&db->fileLock); //an autosave may be renaming over the same files
+    char journal[528];
+    int err = syncJournal(journalPath(db, journal, sizeof journal) ? journal : ""); //a file that fails to save keeps the journal, which must not undo what the others hold
+    if (err) {
+        pthread_mutex_unlock(&db->fileLock);
+        errno = err;
+        return DB_ERR_IO;
+    }
+    runParallel(db->shards, db->shardCount, saveShardJob, args, sizeof args[0]); //every shard goes back to its own file
+    for (size_t i = 0; i < db->shardCount; i++) if (args[i].err != 0 && !err) err = args[i].err;
+    if (!err) { //still under the file lock, so no autosave snapshot can be taken before this and written after it
+        pthread_mutex_lock(&db->lock);
+        db->unsaved = 0; //the files are up to date, the next autosave waits for new changes
+        resetJournal(db); //and hold every committed transaction
+        pthread_mutex_unlock(&db->lock);
+    }
+    pthread_mutex_unlock(&db->fileLock);
+    if (err) {
+        errno = err;
+        return DB_ERR_IO;
+    }
+    return DB_OK;
+}
+
+int db_set_path(Database *db, size_t shard, const char *path) {
+    if (shard >= MAX_SHARDS || shard > db->shardCount || !path) return DB_ERR_INVALID_ARGUMENT;
+    pthread_mutex_lock(&db->lock); //the autosave writer copies paths while it takes a snapshot
+    if (shard == db->shardCount) db->shardCount++; //naming the file of a database that was never opened
+    clean_path(path, db->shards[shard].path, sizeof db->shards[shard].path);
+    pthread_mutex_unlock(&db->lock);
+    return DB_OK;
+}
+
+// =====================================================
+// AUTOSAVE
+// =====================================================
+typedef struct {
+    char path[512];  //file the shard is saved to
+    RowChunk **chunks;  //the shard's chunk table at snapshot time, mutations copy a chunk before changing it
+    size_t count;  //rows in the snapshot
+} ShardSnapshot;
+
+typedef struct {
+    ShardSnapshot shards[MAX_SHARDS];
+    size_t shardCount;
+    int complete;  //1 if every shard is in the snapshot
+    size_t journalBytes;  //journal blocks up to here are part of the snapshot
+    unsigned long journalGen;
+    char journalPath[528];  //journal of the files, empty if there is none
+} Snapshot;
+
+// Helper: free the chunk tables of a snapshot and every chunk replaced while it was written, called without the lock
+static void freeSnapshot(Database *db, Snapshot *snap, RowChunk *retired) {
+    for (size_t i = 0; i < snap->shardCount; i++) dbFree(db, snap->shards[i].chunks);
+    snap->shardCount = 0;
+    while (retired) {
+        RowChunk *next = retired->nextRetired;
+        dbFree(db, retired);
+        retired = next;
+    }
+}
+
+// Helper: point-in-time copy of every shard with a file, only the chunk tables are copied and the chunks are shared
+// the database lock must be held, returns 0 on success
+static int takeSnapshot(Database *db, Snapshot *snap) {
+    snap->shardCount = 0;
+    for (size_t i = 0; i < db->shardCount; i++) {
+        Shard *sh = &db->shards[i];
+        if (sh->lazy || sh->path[0] == '\0') continue; //mapped files never change, inserted rows wait for SAVE to name a file
+        ShardSnapshot *ss = &snap->shards[snap->shardCount];
+        size_t chunks = (sh->count + CHUNK_ROWS - 1) / CHUNK_ROWS;
+        ss->chunks = dbAlloc(db, (chunks ? chunks : 1) * sizeof *ss->chunks);
+        if (!ss->chunks) {
+            freeSnapshot(db, snap, NULL);
+            return -1;
+        }
+        memcpy(ss->chunks, sh->chunks, chunks * sizeof *ss->chunks);
+        memcpy(ss->path, sh->path, sizeof ss->path);
+        ss->count = sh->count;
+        snap->shardCount++;
+    }
+    snap->complete = (snap->shardCount == db->shardCount);
+    snap->journalBytes = db->journalBytes;
+    snap->journalGen = db->journalGen;
+    if (!journalPath(db, snap->journalPath, sizeof snap->journalPath)) snap->journalPath[0] = '\0';
+    db->snapEpoch++; //every existing chunk is now older than the snapshot, so mutations copy it before writing
+    db->snapActive = 1;
+    db->unsaved = 0;
+    return 0;
+}
+
+// Helper: write one shard of a snapshot through a temp file, returns 0 or an errno value
+static int writeSnapshotShard(const ShardSnapshot *ss, size_t *bytes) {
+    char tmp[520];
+    FILE *fp = openTemp(ss->path, tmp, sizeof tmp);
+    if (!fp) return errno ? errno : EIO;
+    fputs(fileHeader, fp);
+    for (size_t r = 0; r < ss->count; r++) //file order, a sorted view is not part of the snapshot
+        writeRecord(fp, &ss->chunks[r / CHUNK_ROWS]->rows[r % CHUNK_ROWS]);
+    long size = ftell(fp);
+    int err = commitTemp(fp, tmp, ss->path, ferror(fp));
+    if (!err && size > 0) *bytes += (size_t)size;
+    return err;
+}
+
+// Helper: append bytes [from, to) of the journal to the temp file and sync it, returns 0 on success
+// both files are closed again, so the temp file can be renamed over the journal on every platform
+static int copyJournal(const char *path, const char *tmp, size_t from, size_t to) {
+    char buf[4096];
+    FILE *in = fopen(path, "rb");
+    FILE *out = in ? fopen(tmp, "ab") : NULL;
+    if (!out) {
+        if (in) fclose(in);
+        return -1;
+    }
+    int failed = fseek(in, (long)from, SEEK_SET) != 0;
+    while (!failed && from < to) {
+        size_t want = (to - from < sizeof buf) ? to - from : sizeof buf;
+        size_t n = fread(buf, 1, want, in);
+        failed = (n == 0) || fwrite(buf, 1, n, out) != n;
+        from += n;
+    }
+    fclose(in);
+    if (!failed) failed = syncFile(out) != 0;
+    if (fclose(out) != 0) failed = 1;
+    return failed ? -1 : 0;
+}
+
+// Helper: drop the journal blocks of a snapshot once it is on disk, called with the file lock but without the database lock
+// the blocks committed after the snapshot are copied and synced without the lock, which is only taken to check that
+// nothing was committed meanwhile and to rename; if commits keep coming the journal is kept whole,
+// replaying blocks the files already hold changes nothing
+static void trimJournal(Database *db, const Snapshot *snap) {
+    char path[528], tmp[540];
+    pthread_mutex_lock(&db->lock);
+    if (snap->journalGen != db->journalGen || !journalPath(db, path, sizeof path)) { //emptied, trimmed or reopened meanwhile
+        pthread_mutex_unlock(&db->lock);
+        return;
+    }
+    if (snap->journalBytes >= db->journalBytes) { //nothing was committed while the snapshot was written
+        resetJournal(db);
+        pthread_mutex_unlock(&db->lock);
+        return;
+    }
+    unsigned long gen = db->journalGen;
+    size_t keep = snap->journalBytes, from = keep, to = db->journalBytes;
+    pthread_mutex_unlock(&db->lock);
+
+    int renamed = 0;
+    snprintf(tmp, sizeof tmp, "%s.tmp", path);
+    remove(tmp);
+    for (int round = 0; round < JOURNAL_TRIM_ROUNDS && !renamed; round++) {
+        if (copyJournal(path, tmp, from, to) != 0) break;
+        pthread_mutex_lock(&db->lock);
+        if (db->journalGen != gen) { //the database was closed or reopened
+            pthread_mutex_unlock(&db->lock);
+            break;
+        }
+        if (db->journalBytes == to) { //the copy is complete, swap it in before the next commit appends
+#ifdef _WIN32
+            renamed = MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+            renamed = rename(tmp, path) == 0;
+#endif
+            if (renamed) {
+                db->journalBytes = to - keep;
+                db->journalGen++;
+            }
+        }
+        from = to; //more blocks were committed during the copy, copy those next
+        to = db->journalBytes;
+        pthread_mutex_unlock(&db->lock);
+    }
+    if (!renamed) remove(tmp);
+}
+
+// Helper: writer thread, snapshots whenever the mutation or time trigger fires and writes outside the lock
+static void *autosaveThread(void *arg) {
+    Database *db = arg;
+    Autosave *as = &db->autosave;
+    Snapshot *snap = dbAlloc(db, sizeof *snap); //every path of a snapshot together is too big for a thread stack
+    struct timespec deadline, t0, t1;
+
+    pthread_mutex_lock(&db->lock);
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += as->stats.seconds;
+    while (!as->stop) {
+        int due = as->stats.mutations && db->unsaved >= as->stats.mutations;
+        if (!due && as->stats.seconds) {
+            if (pthread_cond_timedwait(&as->wake, &db->lock, &deadline) == ETIMEDOUT) {
+                due = db->unsaved > 0; //nothing changed, nothing to write
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_sec += as->stats.seconds;
+            }
+        } else if (!due) {
+            pthread_cond_wait(&as->wake, &db->lock);
+        }
+        if (!due || as->stop) continue; //woken early, check the triggers again
+
+        // the files are locked from before the snapshot until it is on disk, so a SAVE either finishes first
+        // or starts after it, and an older snapshot is never renamed over what SAVE wrote
+        pthread_mutex_unlock(&db->lock);
+        pthread_mutex_lock(&db->fileLock); //always taken before the lock, like SAVE does
+        pthread_mutex_lock(&db->lock);
+        if (as->stop || db->unsaved == 0) { //stopped, or a SAVE wrote every change while this thread waited
+            pthread_mutex_unlock(&db->fileLock);
+            continue;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t0); //the lock is already held, so this only measures the snapshot itself
+        int taken = snap && takeSnapshot(db, snap) == 0;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        as->stats.lastPauseUs = elapsedUs(&t0, &t1);
+        if (as->stats.lastPauseUs > as->stats.maxPauseUs) as->stats.maxPauseUs = as->stats.lastPauseUs;
+        if (!taken) {
+            as->stats.failures++;
+            db->unsaved = 0; //retried after the next change instead of spinning
+            pthread_mutex_unlock(&db->fileLock);
+            continue;
+        }
+        pthread_mutex_unlock(&db->lock);
+
+        // serialise without the lock, the command loop keeps running and copies any chunk it changes
+        int err = syncJournal(snap->journalPath); //changes up to the snapshot are all in the journal before a file holds them
+        size_t bytes = 0;
+        for (size_t i = 0; !err && i < snap->shardCount; i++) {
+            int e = writeSnapshotShard(&snap->shards[i], &bytes);
+            if (e && !err) err = e; //keep writing the other files
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        pthread_mutex_lock(&db->lock);
+        db->snapActive = 0; //chunks are no longer shared
+        RowChunk *retired = db->retired;
+        db->retired = NULL;
+        pthread_mutex_unlock(&db->lock);
+        freeSnapshot(db, snap, retired); //outside the lock, there may be many
+
+        if (!err && snap->complete) trimJournal(db, snap); //transactions up to the snapshot are in the files now
+        pthread_mutex_lock(&db->lock);
+        as->stats.lastWriteMs = elapsedUs(&t0, &t1) / 1e3;
+        as->stats.lastBytes = bytes;
+        as->stats.totalBytes += bytes;
+        if (err) as->stats.failures++; //the previous file is still in place
+        else as->stats.snapshots++;
+        pthread_mutex_unlock(&db->fileLock);
+    }
+    pthread_mutex_unlock(&db->lock);
+    dbFree(db, snap);
+    return NULL;
+}
+
+int db_autosave_start(Database *db, unsigned seconds, unsigned mutations) {
+    if (seconds == 0 && mutations == 0) return DB_ERR_INVALID_ARGUMENT;
+    db_autosave_stop(db); //a running writer is replaced with the new policy
+
+    pthread_mutex_lock(&db->lock);
+    db->autosave.stop = 0;
+    db->autosave.stats.seconds = seconds;
+    db->autosave.stats.mutations = mutations;
+    int err = pthread_create(&db->autosave.thread, NULL, autosaveThread, db);
+    db->autosave.stats.enabled = (err == 0);
+    pthread_mutex_unlock(&db->lock);
+    if (err) {
+        errno = err;
+        return DB_ERR_IO;
+    }
+    return DB_OK;
+}
+
+void db_autosave_stop(Database *db) {
+    pthread_mutex_lock(&db->lock);
+    int running = db->autosave.stats.enabled;
+    db->autosave.stop = 1;
+    db->autosave.stats.enabled = 0;
+    pthread_cond_signal(&db->autosave.wake);
+    pthread_mutex_unlock(&db->lock);
+    if (running) pthread_join(db->autosave.thread, NULL); //a snapshot being written is finished first
+}
+
+void db_autosave_stats(Database *db, AutosaveStats *out) {
+    pthread_mutex_lock(&db->lock); //counters are written by the writer thread
+    *out = db->autosave.stats;
+    pthread_mutex_unlock(&db->lock);
+}
+
+// =====================================================
+// EXPORT TO CSV
+// =====================================================
+typedef struct {
+    char *text;  //every row of the shard formatted as csv
+    size_t len;
+    size_t *lineStart;  //offset of each row inside text, plus one entry for the end
+    int err;
+} CsvBuffer;
+
+static void formatCsvJob(Shard *sh, void *arg) {
+    CsvBuffer *b = arg;
+    size_t cap = sh->count * 64 + 1; //rough guess, grown when needed
+    b->text = dbAlloc(sh->db, cap);
+    b->lineStart = dbAlloc(sh->db, (sh->count + 1) * sizeof *b->lineStart);
+    b->len = 0;
+    b->err = (!b->text || !b->lineStart);
+
+    for (size_t i = 0; !b->err && i < sh->count; i++) {
+        const Student *s = rowAt(sh, i);
+        char line[160];
+        int n = snprintf(line, sizeof line, "%d,\"%s\",\"%s\",%.1f,%c\n",
+                         s->id, s->name, s->programme, s->mark, s->grade);
+        if (b->len + (size_t)n + 1 > cap) {
+            cap = cap * 2 + (size_t)n;
+            char *grown = dbResize(sh->db, b->text, cap);
+            if (!grown) { b->err = 1; break; }
+            b->text = grown;
+        }
+        b->lineStart[i] = b->len;
+        memcpy(b->text + b->len, line, (size_t)n);
+        b->len += (size_t)n;
+    }
+    if (!b->err) b->lineStart[sh->count] = b->len;
+}
+
+// Helper: a full export succeeded, it is the baseline for the next EXPORT CHANGES of the default checkpoint
+// and of every checkpoint whose reader was told to take one
+static void exportedAll(Database *db) {
+    findCheckpoint(db, DEFAULT_CHECKPOINT);
+    int lost = db->changeLogFailed;
+    if (lost) { //a change was never logged, the log starts over from this export
+        db->changeLogFailed = 0;
+        db->changeBase += db->changeCount;
+        db->changeCount = 0;
+        for (int f = 0; f < SORT_FIELD_COUNT; f++) //the missing change may have moved rows of any view
+            for (int d = 0; d < 2; d++) db->views[f][d].built = 0;
+    }
+    for (size_t i = 0; i < db->checkpointCount; i++) {
+        Checkpoint *c = &db->checkpoints[i];
+        int waiting = c->partial || strcmp(c->name, DEFAULT_CHECKPOINT) == 0;
+        if (!waiting && !lost) continue; //its own baseline is still complete
+        c->seq = db_version(db);
+        c->partial = !waiting; //after a lost change, readers that did not ask for this export need their own
+    }
+}
+
+int db_export_csv(Database *db, const char *csvPath) {
+    FILE *csv = fopen(csvPath, "w"); //open the csv file for writing. "w" creates/overwrites the file
+    if (!csv) return DB_ERR_IO; //file cannot be opened/created
+
+    fprintf(csv, "ID,Name,Programme,Mark,Grade\n"); //write the csv header row
+    if (db->lazyMode) { //lazily opened files can be larger than memory, so they are streamed instead of formatted per shard
+        size_t n = db_count(db);
+        for (size_t i = 0; i < n; i++) {
+            const Student *s = db_get(db, i);
+            if (!s) { //the file changed underneath the mapping
+                fclose(csv);
+                errno = EIO;
+                return DB_ERR_IO;
+            }
+            fprintf(csv, "%d,\"%s\",\"%s\",%.1f,%c\n",
+                    s->id, s->name,
+                    s->programme, s->mark,
+                    s->grade);
+        } //quotation marks are added around strings to avoid issues if the name contains spaces
+        if (fclose(csv) != 0) return DB_ERR_IO;
+        exportedAll(db);
+        return DB_OK;
+    }
+
+    CsvBuffer bufs[MAX_SHARDS];
+    int rc = DB_OK;
+    if (db->shardCount > 0) runParallel(db->shards, db->shardCount, formatCsvJob, bufs, sizeof bufs[0]); //each shard formats its own rows
+    for (size_t i = 0; i < db->shardCount; i++) if (bufs[i].err) rc = DB_ERR_NO_MEMORY;
+
+    RowCursor c = {currentView(db), 0, 0, 0};
+    size_t row;
+    long s;
+    while (rc == DB_OK && (s = nextRow(db, &c, &row)) >= 0) { //write the formatted rows in the current order
+        const CsvBuffer *b = &bufs[s];
+        fwrite(b->text + b->lineStart[row], 1, b->lineStart[row + 1] - b->lineStart[row], csv);
+    }
+
+    for (size_t i = 0; i < db->shardCount; i++) {
+        dbFree(db, bufs[i].text);
+        dbFree(db, bufs[i].lineStart);
+    }
+    if (fclose(csv) != 0 && rc == DB_OK) rc = DB_ERR_IO; //close csv file to save changes
+    if (rc == DB_OK) exportedAll(db);
+    return rc;
+}
+
+// =====================================================
+// EXPORT CHANGES TO CSV
+// =====================================================
+typedef struct {
+    int id;
+    int used;
+    ChangeOp first, last;  //first and last change of this ID since the checkpoint
+} NetChange;
+
+long db_export_changes(Database *db, const char *csvPath, const char *checkpoint) {
+    Checkpoint *cp = findCheckpoint(db, (checkpoint && checkpoint[0]) ? checkpoint : DEFAULT_CHECKPOINT);
+    if (!cp) return DB_ERR_TOO_MANY_CHECKPOINTS;
+    if (db->changeLogFailed) return DB_ERR_LOG_INCOMPLETE;
+    if (cp->partial) return DB_ERR_LOG_INCOMPLETE; //no baseline in this session yet, the reader needs a full EXPORT
+
+    // fold the changes since the checkpoint into one net change per ID, in order of first change
+    size_t window = db_version(db) - cp->seq, cap = 16;
+    while (cap < window * 2) cap *= 2; //hash table at most half full, so cost stays O(changes)
+    NetChange *net = dbZalloc(db, cap * sizeof *net);
+    size_t *order = dbAlloc(db, (window ? window : 1) * sizeof *order);
+    if (!net || !order) {
+        dbFree(db, net);
+        dbFree(db, order);
+        return DB_ERR_NO_MEMORY;
+    }
+    size_t distinct = 0;
+    for (size_t i = cp->seq - db->changeBase; i < db->changeCount; i++) {
+        const ChangeEntry *e = &db->changeLog[i];
+        size_t h = ((unsigned)e->id * 2654435761u) & (cap - 1);
+        while (net[h].used && net[h].id != e->id) h = (h + 1) & (cap - 1);
+        if (!net[h].used) {
+            net[h].used = 1;
+            net[h].id = e->id;
+            net[h].first = e->op;
+            order[distinct++] = h;
+        }
+        net[h].last = e->op;
+    }
+
+    FILE *csv = fopen(csvPath, "w"); //open the csv file for writing. "w" creates/overwrites the file
+    if (!csv) {
+        dbFree(db, net);
+        dbFree(db, order);
+        return DB_ERR_IO;
+    }
+
+    fprintf(csv, "Op,ID,Name,Programme,Mark,Grade\n"); //write the csv header row
+    long written = 0;
+    for (size_t i = 0; i < distinct; i++) {
+        const NetChange *c = &net[order[i]];
+        IdSlot *slot = idFind(db, c->id);
+        if (c->first == CHANGE_INSERT && !slot) continue; //inserted and deleted again, the reader never saw it
+        if (!slot) { //deleted rows only need their ID
+            fprintf(csv, "DELETE,%d,,,,\n", c->id);
+        } else {
+            const Student *s = shardRow(&db->shards[slot->shard], slot->row);
+            fprintf(csv, "%s,%d,\"%s\",\"%s\",%.1f,%c\n",
+                    c->first == CHANGE_INSERT ? "INSERT" : "UPDATE",
+                    s->id, s->name, s->programme, s->mark, s->grade);
+        }
+        written++;
+    }
+
+    dbFree(db, net);
+    dbFree(db, order);
+    if (fclose(csv) != 0) return DB_ERR_IO;
+    cp->seq = db_version(db); //next export under this name starts after these changes
+    return written;
+}
+
+// =====================================================
+// ACCESSORS
+// =====================================================
+size_t db_count(const Database *db) {
+    size_t n = 0;
+    for (size_t i = 0; i < db->shardCount; i++) n += db->shards[i].count;
+    return n;
+}
+
+const Student *db_get(Database *db, size_t idx) {
+    for (size_t i = 0; i < db->shardCount; i++) { //find the shard holding this position
+        if (idx < db->shards[i].count) return shardRow(&db->shards[i], idx);
+        idx -= db->shards[i].count;
+    }
+    return NULL;
+}
+
+int db_foreach(Database *db, DbVisitor visit, void *ctx) {
+    RowCursor c = {currentView(db), 0, 0, 0}; //a sorted view spans every file
+    size_t row;
+    long sh;
+    while ((sh = nextRow(db, &c, &row)) >= 0) {
+        const Student *s = shardRow(&db->shards[sh], row);
+        if (s && visit(s, ctx)) break; //visitor asked to stop
+    }
+    return DB_OK;
+}
+
+size_t db_shard_count(const Database *db) {
+    return db->shardCount;
+}
+
+const char *db_shard_path(const Database *db, size_t shard) {
+    return (shard < db->shardCount) ? db->shards[shard].path : "";
+}
+
+// =====================================================
+// SUMMARY
+// =====================================================
+typedef struct {
+    double total;  //sum of the shard's marks
+    float high, low;  //highest and lowest mark in the shard
+    size_t rowH, rowL;  //rows holding them
+    int gradeCounts[5];  //A, B, C, D, F
+    int failed;  //1 if a mapped row no longer parses
+} ShardStats;
+
+static void shardStatsJob(Shard *sh, void *arg) {
+    ShardStats *st = arg;
+    memset(st, 0, sizeof *st);
+    for (size_t i = 0; i < sh->count; i++) {
+        const Student *s = shardRow(sh, i);
+        if (!s) {
+            st->failed = 1;
+            return;
+        }
+        st->total += s->mark;
+        if (i == 0 || s->mark > st->high) { st->high = s->mark; st->rowH = i; }
+        if (i == 0 || s->mark < st->low) { st->low = s->mark; st->rowL = i; }
+        switch (s->grade) {
+            case 'A': st->gradeCounts[0]++; break;
+            case 'B': st->gradeCounts[1]++; break;
+            case 'C': st->gradeCounts[2]++; break;
+            case 'D': st->gradeCounts[3]++; break;
+            case 'F': st->gradeCounts[4]++; break;
+        }
+    }
+}
+
+int db_summary(Database *db, DbSummary *out) {
+    memset(out, 0, sizeof *out);
+    out->count = db_count(db);
+    if (out->count == 0) return DB_OK; //if no records, nothing to summarize
+
+    ShardStats stats[MAX_SHARDS];
+    runParallel(db->shards, db->shardCount, shardStatsJob, stats, sizeof stats[0]); //each shard is summarised on its own thread
+
+    // combine the per-shard totals, highest and lowest marks
+    double total = 0;
+    long shardH = -1, shardL = -1; //shards holding the highest and lowest mark
+    for (size_t i = 0; i < db->shardCount; i++) {
+        if (stats[i].failed) { //the file changed underneath the mapping
+            memset(out, 0, sizeof *out);
+            errno = EIO;
+            return DB_ERR_IO;
+        }
+        if (db->shards[i].count == 0) continue;
+        total += stats[i].total;
+        for (int g = 0; g < 5; g++) out->gradeCounts[g] += stats[i].gradeCounts[g];
+        if (shardH < 0 || stats[i].high > stats[shardH].high) shardH = (long)i;
+        if (shardL < 0 || stats[i].low < stats[shardL].low) shardL = (long)i;
+    }
+
+    out->average = total / out->count;
+    out->high = stats[shardH].high;
+    out->low = stats[shardL].low;
+    const Student *high = shardRow(&db->shards[shardH], stats[shardH].rowH);
+    if (high) snprintf(out->highName, sizeof out->highName, "%s", high->name);
+    const Student *low = shardRow(&db->shards[shardL], stats[shardL].rowL); //high's name is copied first, decoding may reuse its slot
+    if (low) snprintf(out->lowName, sizeof out->lowName, "%s", low->name);
+    if (!high || !low) {
+        memset(out, 0, sizeof *out);
+        errno = EIO;
+        return DB_ERR_IO;
     }
+    return DB_OK;
 }
@@ -1,7 +1,8 @@
 #include <stdio.h>  // for printf, fgets, perror
 #include <string.h>  // for strcmp, strncpy, strlen, strstr
-#include <ctype.h>  // for toupper
-#include "database.h"  //database functions  
+#include <ctype.h>  // for toupper, isdigit
+#include <stdlib.h>  // for atoi, atof
+#include "database.h"  //database functions
 
 #define PATH_LENGTH 512  // defined reusable constant for path length
 
@@ -22,24 +23,319 @@ static void upper_inplace(char *s){
 // helper: parse command string to enum
 CommandType parseCommand(const char *cmd) {
     if (strcmp(cmd, "HELP") == 0) return CMD_HELP;
-    if (strcmp(cmd, "OPEN") == 0) return CMD_OPEN;
+    if (strcmp(cmd, "OPEN") == 0 || strcmp(cmd, "OPEN LAZY") == 0) return CMD_OPEN;
     if (strncmp(cmd, "SHOW ALL", 8) == 0) return CMD_SHOW_ALL;
     if (strcmp(cmd, "QUERY") == 0) return CMD_QUERY;
+    if (strncmp(cmd, "FIND NAME", 9) == 0) return CMD_FIND;
     if (strcmp(cmd, "UPDATE") == 0) return CMD_UPDATE;
     if (strcmp(cmd, "INSERT") == 0) return CMD_INSERT;
     if (strcmp(cmd, "DELETE") == 0) return CMD_DELETE;
     if (strcmp(cmd, "SAVE") == 0) return CMD_SAVE;
     if (strcmp(cmd, "SUMMARY") == 0) return CMD_SUMMARY;
-    if (strcmp(cmd, "EXPORT") == 0) return CMD_EXPORT;
+    if (strcmp(cmd, "EXPORT") == 0 || strncmp(cmd, "EXPORT CHANGES", 14) == 0) return CMD_EXPORT;
+    if (strcmp(cmd, "STATS") == 0) return CMD_STATS;
+    if (strncmp(cmd, "AUTOSAVE", 8) == 0) return CMD_AUTOSAVE;
+    if (strcmp(cmd, "BEGIN") == 0) return CMD_BEGIN;
+    if (strcmp(cmd, "COMMIT") == 0) return CMD_COMMIT;
+    if (strcmp(cmd, "ROLLBACK") == 0) return CMD_ROLLBACK;
     if (strcmp(cmd, "EXIT") == 0) return CMD_EXIT;
     return CMD_UNKNOWN;
 }
 
+// =====================================================
+// Helper: validation messages, the database only returns error codes
+// =====================================================
+static int checkName(const char *name) {
+    if (name[0] == '\0') {
+        printf("Invalid name. Name cannot be empty.\n");
+        return 0;
+    }
+    if (!isValidName(name)) {
+        printf("Invalid name. Only letters and spaces allowed.\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int checkProgramme(const char *programme) {
+    if (!isValidProgramme(programme)) {
+        printf("Invalid programme. Use CS, CE, EE, AI, or DSC and the field cannot be empty.\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int checkMark(float mark) {
+    if (!isValidMark(mark)) {
+        printf("Invalid mark. Must be between 1 and 100.\n");
+        return 0;
+    }
+    return 1;
+}
+
+// =====================================================
+// QUERY
+// =====================================================
+static const Student *queryRecord(Database *db, int id) {
+    const Student *s = db_query(db, id);
+    if (s) { //prints the data associated with the ID
+        printf("\nRecord found:\n");
+        printf("ID\t: %d\n", s->id);
+        printf("Name\t: %s\n", s->name);
+        printf("Programme: %s\n", s->programme);
+        printf("Mark\t: %.2f\n", s->mark);
+        printf("Grade\t: %c\n", s->grade);
+        return s;
+    }
+    printf("\nNo record found with ID %d.\n", id);
+    return NULL;
+}
+
+// =====================================================
+// UPDATE
+// =====================================================
+static void updateRecord(Database *db, int id) {
+    if (db_is_lazy(db)) {
+        printf("%s.\n", db_strerror(DB_ERR_READ_ONLY));
+        return;
+    }
+    const Student *found = queryRecord(db, id); //checks if the student exists and prints it
+    if (!found) return;
+    Student rec = *found; //edited copy, handed back to the database in one call
+    char buffer[64];
+
+    // NAME
+    printf("\nEnter new name (Enter to keep. Letters and spaces only allowed): ");
+    if (!read_line(buffer, sizeof buffer)) return;
+    if (buffer[0] != '\0' && checkName(buffer)) //only update if theres an input, empty = keep old record
+        strcpy(rec.name, buffer);
+
+    // PROGRAMME
+    printf("Enter new programme (Enter to keep. CS,CE,EE,AI,DSC only allowed): ");
+    if (!read_line(buffer, sizeof buffer)) return;
+    if (buffer[0] != '\0' && checkProgramme(buffer)) //update if user entered something and programme is valid
+        strcpy(rec.programme, fullProgramme(buffer)); //fullProgramme() converts 2-3 letter code to its full name
+
+    // MARK
+    printf("Enter new mark (Enter to keep. Within 1-100 only): ");
+    if (!read_line(buffer, sizeof buffer)) return;
+    if (buffer[0] != '\0') {
+        if (!isNumericString(buffer)) {
+            printf("Invalid mark. Must be numeric.\n");
+            return;
+        }
+        float m = atof(buffer); //convert string into float
+        if (!checkMark(m)) return; //check if its from 1-100 range
+        rec.mark = m;
+    }
+
+    int rc = db_update(db, &rec); //grade is recalculated by the database
+    if (rc != DB_OK) {
+        printf("%s.\n", db_strerror(rc));
+        return;
+    }
+    printf("\nRecord updated successfully!\n");
+}
+
+// =====================================================
+// INSERT
+// =====================================================
+static void insertRecord(Database *db) {
+    if (db_is_lazy(db)) {
+        printf("%s.\n", db_strerror(DB_ERR_READ_ONLY));
+        return;
+    }
+
+    Student s; //temporary student record used to store all new input
+    char buf[64]; //input buffer for reading strings like ID and mark
+    size_t target = 0; //file the new record goes into
+    size_t files = db_shard_count(db);
+
+    // TARGET FILE (only asked when several files are open)
+    if (files > 1) {
+        for (size_t i = 0; i < files; i++)
+            printf("  %zu. %s\n", i + 1, db_shard_path(db, i));
+        printf("Enter target file number (1-%zu): ", files);
+        if (!read_line(buf, sizeof buf)) return;
+        int choice = atoi(buf);
+        if (choice < 1 || (size_t)choice > files) {
+            printf("Invalid file number.\n");
+            return;
+        }
+        target = (size_t)choice - 1;
+    }
+
+    // ID
+    printf("\nEnter new student ID (7 digits): ");
+    if (!read_line(buf, sizeof buf)) return;
+
+    if (buf[0] == '\0') { printf("ID cannot be empty.\n"); return; } //empty input check
+    for (int i = 0; buf[i]; i++) //ensure ID contains numeric input only
+        if (!isdigit((unsigned char)buf[i])) {
+            printf("ID must be numeric.\n");
+            return;
+        }
+
+    s.id = atoi(buf); //convert string to integer once validated
+    if (s.id < 1000000 || s.id > 9999999) { //check that ID is exactly 7 digits and cannot start with 0
+        printf("Invalid ID length. Must be 7 digits and cannot start with 0.\n");
+        return;
+    }
+    if (db_query(db, s.id)) { //prevent duplicate IDs across every file
+        printf("ID already exists.\n");
+        return;
+    }
+
+    // NAME
+    printf("Enter name: ");
+    if (!read_line(s.name, sizeof s.name)) return;
+    if (!checkName(s.name)) return; //validates that name contains letters and spaces plus its not empty
+
+    // PROGRAMME
+    printf("Enter programme (CS/CE/EE/AI/DSC): ");
+    if (!read_line(s.programme, sizeof s.programme)) return;
+    if (!checkProgramme(s.programme)) return; //have to match one of the allowed codes
+
+    // MARK
+    printf("Enter mark (1-100): ");
+    if (!read_line(buf, sizeof buf)) return;
+
+    if (buf[0] == '\0') { printf("Mark cannot be empty.\n"); return; } //empty check
+    if (!isNumericString(buf)) { printf("Invalid mark. Must be numeric.\n"); return; } //reject letters/symbols
+
+    s.mark = atof(buf); //convert string to float
+    if (!checkMark(s.mark)) return; //ensure mark is within allowed range which is 1-100
+    //calls fullProgramme to convert short code to full name
+    strcpy(s.programme, fullProgramme(s.programme));
+
+    int rc = db_insert(db, target, &s); //grade is calculated by the database
+    if (rc != DB_OK) {
+        printf("Cannot insert: %s.\n", db_strerror(rc));
+        return;
+    }
+    printf("\nRecord inserted successfully!\n");
+}
+
+// =====================================================
+// DELETE
+// =====================================================
+static void deleteRecord(Database *db, int id) {
+    if (db_is_lazy(db)) {
+        printf("%s.\n", db_strerror(DB_ERR_READ_ONLY));
+        return;
+    }
+    const Student *s = db_query(db, id); //search for the record with the matching ID
+    if (!s) {
+        printf("No record found with ID %d.\n", id);
+        return;
+    }
+
+    printf("Found: ID=%d, Name=%s, Programme=%s, Mark=%.2f\n", //display record before deleting it
+           s->id, s->name, s->programme, s->mark);
+
+    char conf[8];
+    printf("Confirm delete? (Y/N): ");
+    if (!read_line(conf, sizeof conf) || (conf[0] != 'Y' && conf[0] != 'y')) { //if the user does not type either Y or y, cancel the deletion
+        printf("Deletion cancelled.\n");
+        return;
+    }
+
+    int rc = db_delete(db, id);
+    if (rc != DB_OK) {
+        printf("%s.\n", db_strerror(rc));
+        return;
+    }
+    printf("Record deleted.\n");
+}
+
+// =====================================================
+// SHOW ALL (UPDATED ALIGNMENT!)
+// =====================================================
+static int printRow(const Student *s, void *ctx) {
+    (void)ctx;
+    printf("%-8d %-20s %-25s %6.1f %5c\n",
+           s->id,
+           s->name,
+           s->programme,
+           s->mark,
+           s->grade);
+    return 0;
+}
+
+static void showAll(Database *db) {
+    printf("-----------------------------------------------------------------------------\n");
+    printf("%-8s %-20s %-25s %6s %5s\n", "ID", "Name", "Programme", "Mark", "Grade");
+    printf("-----------------------------------------------------------------------------\n");
+    db_foreach(db, printRow, NULL); //rows come in the order of the last sort
+    printf("-----------------------------------------------------------------------------\n");
+}
+
+// =====================================================
+// GRADE DISTRIBUTION
+// =====================================================
+static void showGradeDistribution(const int gradeCounts[5], size_t n) {
+    if (n == 0) {
+        return;
+    }
+
+    const char *gradeLabels[] = {"A", "B", "C", "D", "F"};
+    const char *gradeRanges[] = {"(80-100)", "(70-79) ", "(60-69) ", "(50-59) ", "(0-49)  "};
+
+    printf("\n------------------------------------------------------");
+    printf("\n|                 Grade Distribution                 |");
+    printf("\n------------------------------------------------------\n");
+    for (int i = 0; i < 5; i++) {
+        float percentage = (gradeCounts[i] * 100.0) / n;
+        printf("Grade %s %s: %2d students (%.1f%%)\t",
+               gradeLabels[i], gradeRanges[i], gradeCounts[i], percentage);
+
+        // Simple bar chart
+        int bars = (int)(percentage / 5);  // Each bar = 5%
+        for (int j = 0; j < bars; j++) {
+            printf("\xDB");
+        }
+        printf("\n\n");
+    }
+}
+
+// =====================================================
+// SUMMARY
+// =====================================================
+static void showSummary(Database *db) {
+    DbSummary sum;
+    int rc = db_summary(db, &sum);
+    if (rc == DB_ERR_IO) { // a lazily opened file changed on disk
+        perror("SUMMARY failed");
+        return;
+    }
+    if (sum.count == 0) { //if no records, nothing to summarize
+        printf("No records available.\n");
+        return;
+    }
+
+    printf("\n---------------------------------------\n");
+    printf("Summary Statistics\n");
+    printf("---------------------------------------\n");
+    printf("Total students: %zu\n", sum.count);
+    printf("Average mark : %.2f\n", sum.average);
+    printf("Highest mark : %.2f (%s)\n", sum.high, sum.highName);
+    printf("Lowest mark  : %.2f (%s)\n", sum.low, sum.lowName);
+    printf("---------------------------------------\n");
+
+    showGradeDistribution(sum.gradeCounts, sum.count);
+}
+
 // start of main program
 int main(void) {
     int id;
-    char command[64], match[64], current_path[PATH_LENGTH] = "";
+    char command[PATH_LENGTH], match[PATH_LENGTH];
     char path[PATH_LENGTH];   // DECLARE 'path' ONLY ONCE HERE
+    Database *db = db_create(NULL); // every record, file and cache lives in this handle
+
+    if (!db) {
+        perror("Cannot create database");
+        return 1;
+    }
 
     //always loop until user exits
     while (1) {
@@ -58,41 +354,62 @@ int main(void) {
             case CMD_HELP:
                 printf("Available commands:\n");
                 printf("  OPEN       - Open a database file\n");
+                printf("               (Several files or wildcards can be given, separated by commas)\n");
+                printf("               (Optional: OPEN LAZY maps the file read-only and loads rows on demand)\n");
                 printf("  SHOW ALL   - Display all student records\n");
                 printf("               (Optional Sort Syntax: SHOW ALL SORT BY <FIELD> <ORDER>)\n");
                 printf("               <FIELD>: ID, NAME, PROGRAMME, MARK, GRADE\n");
                 printf("               <ORDER>: ASC (Ascending) or DESC (Descending)\n");
                 printf("  QUERY      - Query a student record by ID\n");
+                printf("  FIND NAME  - Find students by part of their name: FIND NAME <TEXT>\n");
+                printf("               (Case-insensitive, best %d matches: whole name, name start, start of a later name, anywhere)\n", FIND_LIMIT);
                 printf("  UPDATE     - Update a student record by ID\n");
                 printf("  INSERT     - Insert a new student record\n");
                 printf("  DELETE     - Delete a student record by ID\n");
                 printf("  SAVE       - Save the current database to file\n");
                 printf("  SUMMARY    - Show summary of records\n");
                 printf("  EXPORT     - Export records to CSV file\n");
+                printf("               (Optional: EXPORT CHANGES <PATH> [CHECKPOINT] writes only rows changed since that checkpoint)\n");
+                printf("  BEGIN      - Start a transaction, INSERT, UPDATE and DELETE are applied together on COMMIT\n");
+                printf("               (QUERY sees the pending changes, SHOW ALL, FIND, SUMMARY and SAVE only committed ones)\n");
+                printf("  COMMIT     - Apply every change of the transaction at once and record it in the journal\n");
+                printf("  ROLLBACK   - Discard every change of the transaction\n");
+                printf("  STATS      - Show engine statistics (sorted view cache, autosave, transactions)\n");
+                printf("  AUTOSAVE   - Save opened files in the background: AUTOSAVE <SECONDS> <MUTATIONS>, AUTOSAVE OFF\n");
+                printf("               (0 disables a trigger, AUTOSAVE alone shows the current policy)\n");
                 printf("  EXIT       - Exit the program\n");
                 break;
 
             //OPEN operation
-            case CMD_OPEN:
-                printf("Enter database file path: "); 
+            case CMD_OPEN: {
+                int lazy = (strstr(match, "LAZY") != NULL); // OPEN LAZY keeps only an ID index in memory
+                printf("Enter database file path(s): ");
                 if (!read_line(path, sizeof path) || path[0] == '\0') { // read the input path and if the user presses Enter without typing anything or if the read fails, cancel it
                     puts("OPEN cancelled.");
                     break;
                 }
 
-                if (openDatabase(path) != 0) { // if openDatabase() returns a non-zero value, an error occurred.
+                int rc = lazy ? db_open_lazy(db, path) : db_open(db, path);
+                if (rc == DB_ERR_IO) { // errno holds the reason the file could not be read
                     perror("OPEN failed");
-                } else {
-                    // store the opened path
-                    strncpy(current_path, path, PATH_LENGTH - 1);
-                    current_path[PATH_LENGTH - 1] = '\0';
-                    printf("Database opened with %zu records.\n", db_count());
+                } else if (rc != DB_OK) {
+                    printf("OPEN failed: %s.\n", db_strerror(rc));
+                } else { // every opened file is remembered by its shard, so SAVE can write it back
+                    if (db_duplicate_count(db) > 0)
+                        printf("Warning: %zu duplicate ID(s) found, QUERY returns the first one.\n", db_duplicate_count(db));
+                    printf("Database opened with %zu records from %zu file(s)%s.\n",
+                           db_count(db), db_shard_count(db), lazy ? " (lazy, read-only)" : "");
+                    TxnStats ts;
+                    db_txn_stats(db, &ts);
+                    if (ts.recovered > 0)
+                        printf("Recovered %lu committed transaction(s) from the journal.\n", ts.recovered);
                 }
                 break;
+            }
 
             //SHOW ALL operation
             case CMD_SHOW_ALL: {
-                size_t n = db_count();
+                size_t n = db_count(db);
                 if (n == 0) {
                     puts("No records to display. Open or insert records first.");
                     continue;
@@ -103,7 +420,8 @@ int main(void) {
                     char field[20] = "";  // to hold field name
                     char order[10] = "";  // to hold order
                     int ascending = 1; // default ascending
-                    if (sscanf(sortParams, "%s %s", field, order) == 2) {
+                    SortField sortField;
+                    if (sscanf(sortParams, "%19s %9s", field, order) == 2) {
                         if(strcmp(order, "ASC") != 0 && strcmp(order, "DESC") != 0) {
                             printf("Invalid sort order: %s. Use ASC or DESC.\n", order);
                             continue;
@@ -111,24 +429,26 @@ int main(void) {
                         ascending = (strcmp(order, "ASC") == 0) ? 1 : 0;
                     }
 
-                    // match the field specified by the user and call sortStudents() with the correct sort category and order
+                    // match the field specified by the user and call db_sort() with the correct sort category and order
 
                     if (strcmp(field, "ID") == 0) {
-                        sortStudents(SORT_ID, ascending);
+                        sortField = SORT_ID;
                     } else if (strcmp(field, "MARK") == 0) {
-                        sortStudents(SORT_MARK, ascending);
+                        sortField = SORT_MARK;
                     } else if (strcmp(field, "GRADE") == 0) {
-                        sortStudents(SORT_GRADE, ascending);
+                        sortField = SORT_GRADE;
                     } else if (strcmp(field, "NAME") == 0) {
-                        sortStudents(SORT_NAME, ascending);
+                        sortField = SORT_NAME;
                     } else if (strcmp(field, "PROGRAMME") == 0) {
-                        sortStudents(SORT_PROGRAMME, ascending);
+                        sortField = SORT_PROGRAMME;
                     } else {
                         printf("Unknown field: %s\n", field); // if the field doesn't match any known category, show an error
                         break;
                     }
+                    int rc = db_sort(db, sortField, ascending);
+                    if (rc != DB_OK) printf("Cannot sort: %s.\n", db_strerror(rc));
                 }
-                showAll();
+                showAll(db);
                 break;
             }
 
@@ -137,12 +457,35 @@ int main(void) {
                 printf("Enter student ID: ");
                 if (!read_line(command, sizeof command)) continue;
                 //if invalid input, won't call queryRecord function
-                if (sscanf(command, "%d", &id) != 1 || id <= 0) { // validate the input by making sure its numeric and positive, empty or non numeric causes it to return 0 and give an error message 
+                if (sscanf(command, "%d", &id) != 1 || id <= 0) { // validate the input by making sure its numeric and positive, empty or non numeric causes it to return 0 and give an error message
                     printf("Invalid ID. Please enter a positive number, it cannot be empty as well.\n");
                     continue;
                 }
-                queryRecord(id);
+                queryRecord(db, id);
+                break;
+
+            //FIND NAME operation
+            case CMD_FIND: {
+                const char *text = command + 9; // the original input, FIND NAME ignores case anyway
+                while (*text == ' ') text++;
+                if (*text == '\0') {
+                    printf("Usage: FIND NAME <TEXT>\n");
+                    continue;
+                }
+                printf("-----------------------------------------------------------------------------\n");
+                printf("%-8s %-20s %-25s %6s %5s\n", "ID", "Name", "Programme", "Mark", "Grade");
+                printf("-----------------------------------------------------------------------------\n");
+                long found = db_find_name(db, text, FIND_LIMIT, printRow, NULL);
+                printf("-----------------------------------------------------------------------------\n");
+                if (found < 0) {
+                    printf("Cannot search: %s.\n", db_strerror((int)found));
+                } else if (found == 0) {
+                    printf("No student name matches \"%s\".\n", text);
+                } else {
+                    printf("%ld match(es)%s.\n", found, found == FIND_LIMIT ? ", refine the text to see others" : "");
+                }
                 break;
+            }
 
             //UPDATE operation
             case CMD_UPDATE:
@@ -152,14 +495,14 @@ int main(void) {
                     printf("Invalid ID. Please enter a positive number, it cannot be empty as well.\n");
                     continue;
                 }
-                updateRecord(id);
+                updateRecord(db, id);
                 break;
 
             //INSERT operation
             case CMD_INSERT:
-                insertRecord();
+                insertRecord(db);
                 break;
-            
+
             //DELETE operation
             case CMD_DELETE:
                 printf("Enter student ID to delete: ");
@@ -168,46 +511,65 @@ int main(void) {
                     puts("Delete cancelled.");
                     continue;
                 }
-                deleteRecord(id);
+                deleteRecord(db, id);
                 break;
 
             //SAVE operation
-            case CMD_SAVE:
-                if (db_count() == 0) {
+            case CMD_SAVE: {
+                if (db_count(db) == 0) {
                     printf("There is no record to save.\n"); //if theres nothing in the database
                     break;
                 }
 
-                if (current_path[0] == '\0') { //if no file was opened, ask user for input
+                if (db_shard_path(db, 0)[0] == '\0') { //if no file was opened, ask user for input
                     printf("No file currently opened.\n");
                     printf("Enter a filename to save as: ");
                     if (!read_line(path, sizeof path) || path[0] == '\0') { //empty input cancels the save
                         printf("SAVE cancelled.\n");
                         break;
                     }
-                    strcpy(current_path, path); //store the new file path so it can be reused
+                    db_set_path(db, 0, path); //store the new file path so it can be reused
                 }
 
-                if (saveDatabase(current_path) == 0) { //attempt to save the database to the file
-                    printf("The database file \"%s\" is successfully saved.\n", current_path);
+                int rc = db_save(db); //attempt to save every opened file
+                if (rc == DB_OK) {
+                    for (size_t i = 0; i < db_shard_count(db); i++)
+                        printf("The database file \"%s\" is successfully saved.\n", db_shard_path(db, i));
                 } else {
+                    if (rc == DB_ERR_IO) perror("SAVE");
                     printf("Failed to save database file.\n");
                 }
                 break;
+            }
 
-            // SUMMARY operation    
+            // SUMMARY operation
             case CMD_SUMMARY:
-                showSummary();
+                showSummary(db);
                 break;
 
             // EXPORT operation
             case CMD_EXPORT:
             {
-                if (db_count() == 0) { //if no records exists
-                    printf("There is no record to export.\n");  
+                // EXPORT CHANGES enhancement feature
+                if (strncmp(match, "EXPORT CHANGES", 14) == 0) {
+                    char csvPath[PATH_LENGTH] = "", checkpoint[50] = ""; // path is taken from the original input to keep its case
+                    if (sscanf(command + 14, "%511s %49s", csvPath, checkpoint) < 1) {
+                        printf("Usage: EXPORT CHANGES <PATH> [CHECKPOINT]\n");
+                        continue;
+                    }
+                    long rows = db_export_changes(db, csvPath, checkpoint);
+                    if (rows >= 0) {
+                        printf("%ld changed record(s) exported to \"%s\".\n", rows, csvPath);
+                    } else {
+                        printf("Failed to export changes: %s.\n", db_strerror((int)rows));
+                    }
+                    break;
+                }
+                if (db_count(db) == 0) { //if no records exists
+                    printf("There is no record to export.\n");
                     continue;
                 }
-                if (exportToCSV("data.csv") == 0) {
+                if (db_export_csv(db, "data.csv") == DB_OK) {
                     printf("The database file \"data.csv\" is successfully exported.\n");
                 } else {
                     printf("Failed to export database.\n");
@@ -215,7 +577,93 @@ int main(void) {
                 break;
             }
 
+            // STATS operation
+            case CMD_STATS: {
+                ViewStats vs;
+                db_view_stats(db, &vs);
+                printf("Sorted view cache: %lu hit(s), %lu miss(es), %lu repair(s)\n", vs.hits, vs.misses, vs.repairs);
+                AutosaveStats as;
+                db_autosave_stats(db, &as);
+                printf("Autosave: %lu snapshot(s), %lu failure(s), last %.2f ms and %zu bytes, %llu bytes in total\n",
+                       as.snapshots, as.failures, as.lastWriteMs, as.lastBytes, as.totalBytes);
+                printf("Autosave pause: last %.1f us, max %.1f us\n", as.lastPauseUs, as.maxPauseUs);
+                TxnStats ts;
+                db_txn_stats(db, &ts);
+                printf("Transactions: %lu committed, %lu rolled back, last commit %.2f ms for %zu change(s)%s\n",
+                       ts.commits, ts.rollbacks, ts.lastCommitMs, ts.lastChanges, ts.open ? ", one open" : "");
+                break;
+            }
+
+            // AUTOSAVE operation
+            case CMD_AUTOSAVE: {
+                unsigned seconds = 0, mutations = 0;
+                if (strcmp(match, "AUTOSAVE OFF") == 0) {
+                    db_autosave_stop(db);
+                    printf("Autosave is off.\n");
+                    break;
+                }
+                if (strcmp(match, "AUTOSAVE") != 0) { // a new policy was given
+                    if (sscanf(match + 8, "%u %u", &seconds, &mutations) != 2 || (seconds == 0 && mutations == 0)) {
+                        printf("Usage: AUTOSAVE <SECONDS> <MUTATIONS> (0 disables a trigger) or AUTOSAVE OFF\n");
+                        continue;
+                    }
+                    int rc = db_autosave_start(db, seconds, mutations);
+                    if (rc != DB_OK) {
+                        perror("AUTOSAVE failed");
+                        break;
+                    }
+                }
+                AutosaveStats as;
+                db_autosave_stats(db, &as);
+                if (!as.enabled) {
+                    printf("Autosave is off.\n");
+                } else {
+                    printf("Autosave is on: every %u second(s) and every %u change(s) (0 = never).\n", as.seconds, as.mutations);
+                }
+                break;
+            }
+
+            // BEGIN / COMMIT / ROLLBACK operations
+            case CMD_BEGIN: {
+                int rc = db_begin(db);
+                if (rc != DB_OK) {
+                    printf("Cannot begin: %s.\n", db_strerror(rc));
+                    break;
+                }
+                printf("Transaction started. Changes are applied on COMMIT.\n");
+                break;
+            }
+
+            case CMD_COMMIT: {
+                int rc = db_commit(db);
+                if (rc == DB_ERR_IO) { // the journal could not be written, nothing was applied
+                    perror("COMMIT failed");
+                    break;
+                }
+                if (rc != DB_OK) {
+                    printf("Cannot commit: %s.\n", db_strerror(rc));
+                    break;
+                }
+                TxnStats ts;
+                db_txn_stats(db, &ts);
+                printf("Transaction committed: %zu change(s) applied.\n", ts.lastChanges);
+                break;
+            }
+
+            case CMD_ROLLBACK: {
+                TxnStats ts;
+                db_txn_stats(db, &ts);
+                int rc = db_rollback(db);
+                if (rc != DB_OK) {
+                    printf("Cannot roll back: %s.\n", db_strerror(rc));
+                    break;
+                }
+                printf("Transaction rolled back: %zu pending change(s) discarded.\n", ts.pending);
+                break;
+            }
+
             case CMD_EXIT: //exit operation
+                db_destroy(db);
                 return 0;
 
             default: //unknown input goes here
@@ -223,5 +671,6 @@ int main(void) {
                 break;
         }
     }
+    db_destroy(db);
     return 0;
 }